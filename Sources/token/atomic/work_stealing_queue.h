@@ -3,7 +3,7 @@
 
 #include <atomic>
 #include <vector>
-#include "common.h"
+#include "token/common.h"
 
 namespace token{
   namespace atomic{
@@ -46,7 +46,9 @@ namespace token{
           bottom_.store(bottom, std::memory_order_release);
         }
 
-        std::atomic_thread_fence(std::memory_order_release);
+        // the store to bottom_ must be visible before top_ is read, otherwise a concurrent Steal
+        // can take the same (last) element
+        std::atomic_thread_fence(std::memory_order_seq_cst);
         uint64_t top = top_.load(std::memory_order_acquire);
         if(top <= bottom){
           auto next = data_[bottom % data_.size()];
@@ -67,7 +69,7 @@ namespace token{
 
       T Steal(){
         uint64_t top = top_.load(std::memory_order_acquire);
-        std::atomic_thread_fence(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
         uint64_t bottom = bottom_.load(std::memory_order_acquire);
         if(top < bottom){
           auto next = data_[top % data_.size()];
@@ -2,7 +2,7 @@
 #define TOKEN_BLOCK_H
 
 #include "token/timestamp.h"
-#include "token/transaction.h"
+#include "token/transaction_view.h"
 
 namespace token{
  class Block;
@@ -13,25 +13,140 @@ namespace token{
    virtual void Visit(const Block& blk) const = 0;
  };
 
+ /**
+  * Blocks are immutable once constructed (or decoded), so the encoded size is cached along w/ the
+  * hash (see BinaryObject). Copies and assignments take both over from the source block.
+  *
+  * A block read from the table encoding (see WriteTableTo) decodes its transactions on first
+  * access, one at a time. Like the hash that happens in const accessors, so a lazy block must be
+  * fully decoded (e.g. by calling transactions()) before it's shared between threads.
+  */
  class Block : public BinaryObject{
+  public:
+   static constexpr const uint64_t kHeaderSize = sizeof(UnsignedLong) + sizeof(RawTimestamp) + sizeof(UnsignedLong);
+
+   /**
+    * The size of the table encoding w/o the transactions, the offset table has an entry for
+    * every transaction plus one for the end of the block.
+    */
+   static inline uint64_t
+   GetTableHeaderSize(uint64_t num_transactions){
+     return kHeaderSize + ((num_transactions + 1) * sizeof(UnsignedLong));
+   }
   private:
    uint64_t height_;
    Timestamp timestamp_;
-   IndexedTransaction* transactions_;
+   mutable IndexedTransaction* transactions_; // allocated on first access if the block is lazy
    uint64_t num_transactions_;
+   mutable uint64_t buffer_size_; // 0 until computed
+   BufferPtr encoded_; // the table encoding if the transactions are decoded lazily
+   mutable std::vector<bool> decoded_;
+
+   uint64_t ComputeBufferSize() const{
+     if(IsLazy())
+       return kHeaderSize + (encoded_->length() - GetTableHeaderSize(GetNumberOfTransactions()));
+     uint64_t size = 0;
+     size += sizeof(uint64_t); // height_
+     size += sizeof(RawTimestamp); // timestamp_
+     size += GetListBufferSize(transactions(), GetNumberOfTransactions());
+     return size;
+   }
+
+   uint64_t GetTransactionOffset(uint64_t idx) const{
+     return encoded_->GetUnsignedLong(kHeaderSize + (idx * sizeof(UnsignedLong)));
+   }
+
+   void DecodeTransaction(uint64_t idx) const{
+     if(transactions_ == nullptr){
+       transactions_ = new IndexedTransaction[GetNumberOfTransactions()];
+       decoded_.assign(GetNumberOfTransactions(), false);
+     }
+     decoded_[idx] = true;
+
+     // the extent has been checked by ReadTableFrom
+     Reader<> reader(encoded_, GetTransactionOffset(idx), GetTransactionOffset(idx + 1));
+     if(!transactions_[idx].ReadFrom(reader) || reader.GetBytesRemaining() > 0)
+       LOG(FATAL) << "cannot decode transaction #" << idx << " of block " << height() << ".";
+   }
+
+   // whether length bytes hold exactly one encoded IndexedTransaction
+   static inline bool
+   IsTransactionExtent(const uint8_t* bytes, uint64_t length){
+     uint64_t num_inputs, num_outputs;
+     return length >= sizeof(UnsignedLong)
+         && TransactionView::Parse(&bytes[sizeof(UnsignedLong)], length - sizeof(UnsignedLong), &num_inputs, &num_outputs) == (length - sizeof(UnsignedLong));
+   }
+
+   void Materialize() const{
+     for(uint64_t idx = 0; IsLazy() && idx < GetNumberOfTransactions(); idx++){
+       if(!IsDecoded(idx))
+         DecodeTransaction(idx);
+     }
+   }
+
+   // copies the transactions of rhs, a lazy block stays lazy and shares the encoded bytes
+   void CopyTransactions(const Block& rhs){
+     num_transactions_ = rhs.GetNumberOfTransactions();
+     encoded_ = rhs.encoded_;
+     decoded_ = rhs.decoded_;
+     if(rhs.transactions_ == nullptr){
+       transactions_ = nullptr;
+       return;
+     }
+     // undecoded slots must stay empty, ReadFrom doesn't release what's been assigned to them
+     transactions_ = new IndexedTransaction[rhs.GetNumberOfTransactions()];
+     for(uint64_t idx = 0; idx < rhs.GetNumberOfTransactions(); idx++){
+       if(rhs.IsDecoded(idx))
+         transactions_[idx] = rhs.transactions_[idx];
+     }
+   }
   public:
-   Block() = default;
+   Block():
+    BinaryObject(),
+    height_(0),
+    timestamp_(),
+    transactions_(nullptr),
+    num_transactions_(0),
+    buffer_size_(0),
+    encoded_(),
+    decoded_(){
+   }
    Block(uint64_t height, const Timestamp& timestamp, IndexedTransaction* transactions, uint64_t num_transactions):
+    BinaryObject(),
     height_(height),
     timestamp_(timestamp),
     transactions_(new IndexedTransaction[num_transactions]),
-    num_transactions_(num_transactions){
+    num_transactions_(num_transactions),
+    buffer_size_(0),
+    encoded_(),
+    decoded_(){
      std::copy(transactions, transactions + num_transactions, transactions_begin());
    }
-   ~Block(){
+   explicit Block(const BufferPtr& data):
+    Block(){
+     Reader<> reader(data);
+     if(!ReadFrom(reader) || !reader.Commit())
+       LOG(ERROR) << "cannot parse block from buffer.";
+   }
+   Block(const Block& rhs):
+    BinaryObject(rhs),
+    height_(rhs.height()),
+    timestamp_(rhs.timestamp()),
+    transactions_(nullptr),
+    num_transactions_(0),
+    buffer_size_(rhs.buffer_size_),
+    encoded_(),
+    decoded_(){
+     CopyTransactions(rhs);
+   }
+   ~Block() override{
      delete[] transactions_;
    }
 
+   Type type() const override{
+     return Type::kBlock;
+   }
+
    uint64_t height() const{
      return height_;
    }
@@ -40,52 +155,243 @@ namespace token{
      return timestamp_;
    }
 
-   Transaction* transactions() const{
+   // decodes all transactions of a lazy block
+   IndexedTransaction* transactions() const{
+     Materialize();
      return transactions_;
    }
 
+   const IndexedTransaction& GetTransaction(uint64_t idx) const{
+     if(idx >= GetNumberOfTransactions())
+       LOG(FATAL) << "cannot get transaction #" << idx << " of block w/ " << GetNumberOfTransactions() << " transactions.";
+     if(!IsDecoded(idx))
+       DecodeTransaction(idx);
+     return transactions_[idx];
+   }
+
+   bool IsLazy() const{
+     return encoded_ != nullptr;
+   }
+
+   bool IsDecoded(uint64_t idx) const{
+     return !IsLazy() || (transactions_ != nullptr && decoded_[idx]);
+   }
+
    uint64_t GetNumberOfTransactions() const{
      return num_transactions_;
    }
 
-   Transaction* transactions_begin() const{
+   IndexedTransaction* transactions_begin() const{
      return &transactions()[0];
    }
 
-   Transaction* transactions_end() const{
+   IndexedTransaction* transactions_end() const{
      return &transactions()[GetNumberOfTransactions()];
    }
 
    uint64_t GetBufferSize() const override{
+     if(buffer_size_ == 0)
+       buffer_size_ = ComputeBufferSize();
+     return buffer_size_;
+   }
+
+   // the whole block goes through a single cursor, the transactions are written w/o virtual calls
+   template<class Storage>
+   bool WriteTo(Writer<Storage>& writer) const{
+     if(writer.Reserve(sizeof(UnsignedLong) + sizeof(RawTimestamp))){
+       writer.PutUnsignedLong(height());
+       writer.PutTimestamp(timestamp());
+     }
+     if(IsLazy()){
+       // the transactions are encoded the same way in both layouts, they're copied w/o decoding
+       auto offset = GetTableHeaderSize(GetNumberOfTransactions());
+       if(writer.Reserve(sizeof(UnsignedLong)))
+         writer.PutUnsignedLong(GetNumberOfTransactions());
+       return writer.Append(&encoded_->data()[offset], encoded_->length() - offset);
+     }
+     return Serializer<IndexedTransaction>::WriteList(writer, transactions(), GetNumberOfTransactions());
+   }
+
+   // expects an empty block
+   template<class Storage>
+   bool ReadFrom(Reader<Storage>& reader){
+     if(!reader.Require(sizeof(UnsignedLong) + sizeof(RawTimestamp)))
+       return false;
+     InvalidateHash();
+     height_ = reader.GetUnsignedLong();
+     timestamp_ = reader.GetTimestamp();
+     return Serializer<IndexedTransaction>::ReadList(reader, &num_transactions_, &transactions_);
+   }
+
+   bool WriteTo(const BufferPtr& data) const override{
+     Writer<> writer(data);
+     return WriteTo(writer)
+         && writer.Commit();
+   }
+
+   /**
+    * The table encoding is the header followed by the offsets of the transactions (from the start
+    * of the block) and the transactions themselves (see IndexedTransaction::WriteTo), so a reader
+    * can get to the header or a single transaction w/o decoding the rest. It isn't hashed.
+    */
+   uint64_t GetTableBufferSize() const{
+     return GetTableHeaderSize(GetNumberOfTransactions()) + (GetBufferSize() - kHeaderSize);
+   }
+
+   bool WriteTableTo(const BufferPtr& data) const{
+     Writer<> writer(data);
+     if(IsLazy()){
+       writer.Append(encoded_->data(), encoded_->length());
+       return writer.Commit();
+     }
+
+     if(writer.Reserve(kHeaderSize)){
+       writer.PutUnsignedLong(height());
+       writer.PutTimestamp(timestamp());
+       writer.PutUnsignedLong(GetNumberOfTransactions());
+     }
+     auto offset = GetTableHeaderSize(GetNumberOfTransactions());
+     for(uint64_t idx = 0; idx <= GetNumberOfTransactions(); idx++){
+       if(writer.Reserve(sizeof(UnsignedLong)))
+         writer.PutUnsignedLong(offset);
+       if(idx < GetNumberOfTransactions())
+         offset += transactions_[idx].GetBufferSize();
+     }
+     for(auto it = transactions_begin(); it != transactions_end(); it++){
+       if(!it->WriteTo(writer))
+         return false;
+     }
+     return writer.Commit();
+   }
+
+   /**
+    * Only parses the header and checks the offset table, the transactions are decoded on first
+    * access (see GetTransaction). The block keeps a slice of data alive until it's destroyed or
+    * replaced.
+    */
+   bool ReadTableFrom(const BufferPtr& data){
+     auto pos = data->GetReadPosition();
+     if(pos > data->length() || (data->length() - pos) < GetTableHeaderSize(0)){
+       LOG(ERROR) << "cannot decode block table from " << data->ToString() << ".";
+       return false;
+     }
+     auto remaining = data->length() - pos;
+     auto num_transactions = data->GetUnsignedLong(pos + sizeof(UnsignedLong) + sizeof(RawTimestamp));
+     if(num_transactions > ((remaining - GetTableHeaderSize(0)) / sizeof(UnsignedLong))){
+       LOG(ERROR) << "cannot decode " << num_transactions << " transactions from " << data->ToString() << ".";
+       return false;
+     }
+     auto size = data->GetUnsignedLong(pos + GetTableHeaderSize(num_transactions) - sizeof(UnsignedLong));
+     if(size < GetTableHeaderSize(num_transactions) || size > remaining){
+       LOG(ERROR) << "cannot decode block of " << size << " bytes from " << data->ToString() << ".";
+       return false;
+     }
+     // the offsets must be non-decreasing and within the block, the first one follows the table
+     Reader<> offsets(data, pos + kHeaderSize, pos + GetTableHeaderSize(num_transactions));
+     if(!offsets.Require((num_transactions + 1) * sizeof(UnsignedLong)))
+       return false;
+     uint64_t last = GetTableHeaderSize(num_transactions);
+     for(uint64_t idx = 0; idx <= num_transactions; idx++){
+       auto offset = offsets.GetUnsignedLong();
+       if(offset < last || offset > size || (idx == 0 && offset != last)){
+         LOG(ERROR) << "cannot decode block w/ offset " << offset << " for transaction #" << idx << " from " << data->ToString() << ".";
+         return false;
+       }
+       // each transaction must fill its extent exactly, so it can't fail to decode later on
+       if(idx > 0 && !IsTransactionExtent(&data->data()[pos + last], offset - last)){
+         LOG(ERROR) << "cannot decode transaction #" << (idx - 1) << " of " << (offset - last) << " bytes from " << data->ToString() << ".";
+         return false;
+       }
+       last = offset;
+     }
+
+     auto encoded = data->ReadSlice(size);
+     if(!encoded)
+       return false;
+
+     InvalidateHash();
+     height_ = encoded->GetUnsignedLong(0);
+     timestamp_ = FromUnixTimestamp(encoded->GetUnsignedLong(sizeof(UnsignedLong)));
+     delete[] transactions_;
+     transactions_ = nullptr;
+     num_transactions_ = num_transactions;
+     buffer_size_ = 0;
+     encoded_ = encoded;
+     decoded_.clear();
+     return true;
+   }
+
+   /**
+    * See Transaction::WriteCompactTo, the transactions are embedded w/o their own version.
+    */
+   uint64_t GetCompactBufferSize() const{
      uint64_t size = 0;
-     size += sizeof(uint64_t); // height_
-     size += sizeof(uint64_t); // timestamp_
-     size += sizeof(uint64_t); // num_transactions_
-     std::for_each(transactions_begin(), transactions_end(), [&](const Transaction& val){
-       size += val.GetBufferSize();
+     size += Buffer::GetVarintSize(kCompactEncodingVersion);
+     size += Buffer::GetVarintSize(height());
+     size += Buffer::GetVarintSize(ToUnixTimestamp(timestamp()));
+     size += Buffer::GetVarintSize(GetNumberOfTransactions());
+     std::for_each(transactions_begin(), transactions_end(), [&size](const IndexedTransaction& val){
+       size += val.GetCompactBodySize();
      });
      return size;
    }
 
-   bool WriteTo(const BufferPtr& data) const override{
-     if(!data->PutUnsignedLong(height()))
+   bool WriteCompactTo(const BufferPtr& data) const{
+     if(!data->PutVarint(kCompactEncodingVersion)
+     || !data->PutVarint(height())
+     || !data->PutVarint(ToUnixTimestamp(timestamp()))
+     || !data->PutVarint(GetNumberOfTransactions()))
        return false;
-     if(!data->PutTimestamp(timestamp()))
+     for(auto it = transactions_begin(); it != transactions_end(); it++){
+       if(!it->WriteCompactBody(data))
+         return false;
+     }
+     return true;
+   }
+
+   bool ReadCompactFrom(const BufferPtr& data){
+     uint64_t version, height, timestamp, num_transactions;
+     if(!data->GetVarint(&version) || version != kCompactEncodingVersion){
+       LOG(ERROR) << "cannot decode compact block from " << data->ToString() << ".";
+       return false;
+     }
+     if(!data->GetVarint(&height) || !data->GetVarint(&timestamp) || !data->GetVarint(&num_transactions))
        return false;
-     if(!data->PutList(transactions(), GetNumberOfTransactions()))
+     if(num_transactions > (data->length() - data->GetReadPosition()) / IndexedTransaction::kMinCompactBodySize){
+       LOG(ERROR) << "cannot decode " << num_transactions << " transactions from " << data->ToString() << ".";
        return false;
+     }
+
+     auto transactions = new IndexedTransaction[num_transactions];
+     for(uint64_t idx = 0; idx < num_transactions; idx++){
+       if(!transactions[idx].ReadCompactBody(data)){
+         delete[] transactions;
+         return false;
+       }
+     }
+
+     InvalidateHash();
+     height_ = height;
+     timestamp_ = FromUnixTimestamp(timestamp);
+     delete[] transactions_;
+     transactions_ = transactions;
+     num_transactions_ = num_transactions;
+     buffer_size_ = 0;
+     encoded_.reset();
+     decoded_.clear();
      return true;
    }
 
    Block& operator=(const Block& rhs){
      if(&rhs == this)
        return *this;
+     BinaryObject::operator=(rhs);
      height_ = rhs.height();
      timestamp_ = rhs.timestamp();
+     buffer_size_ = rhs.buffer_size_;
 
      delete[] transactions_;
-     transactions_ = new IndexedTransaction[rhs.GetNumberOfTransactions()];
-     std::copy(rhs.transactions_begin(), rhs.transactions_end(), transactions_begin());
+     CopyTransactions(rhs);
      return *this;
    }
 
@@ -0,0 +1,181 @@
+#ifndef TOKEN_BLOCK_VIEW_H
+#define TOKEN_BLOCK_VIEW_H
+
+#include "token/block.h"
+#include "token/transaction_view.h"
+
+namespace token{
+ /**
+  * Read-only access to an encoded block (see Block::WriteTo) w/o decoding it. The transactions are
+  * stored back to back w/ variable sizes, construction walks over their counts once to check the
+  * encoding fits into the buffer, afterwards transactions(idx) is O(idx) and iterating is O(1) per
+  * transaction. The same rules as for TransactionView apply.
+  */
+ class BlockView{
+  public:
+   static constexpr const uint64_t kHeaderSize = Block::kHeaderSize;
+
+   // keeps the buffer alive, so it stays valid when the view it came from goes away
+   class TransactionIterator{
+    private:
+     BufferPtr data_;
+     const uint8_t* bytes_; // start of the block
+     uint64_t base_; // of the block in data_
+     uint64_t size_;
+     uint64_t offset_; // of the transaction in the block
+    public:
+     typedef std::forward_iterator_tag iterator_category;
+     typedef IndexedTransactionView value_type;
+     typedef std::ptrdiff_t difference_type;
+     typedef const IndexedTransactionView* pointer;
+     typedef IndexedTransactionView reference;
+
+     TransactionIterator():
+      data_(),
+      bytes_(nullptr),
+      base_(0),
+      size_(0),
+      offset_(0){
+     }
+     TransactionIterator(const BlockView& block, uint64_t offset):
+      data_(block.data_),
+      bytes_(block.bytes_),
+      base_(block.offset_),
+      size_(block.size_),
+      offset_(offset){
+     }
+     TransactionIterator(const TransactionIterator& rhs) = default;
+     ~TransactionIterator() = default;
+
+     IndexedTransactionView operator*() const{
+       return IndexedTransactionView(data_, base_ + offset_);
+     }
+
+     TransactionIterator& operator++(){
+       offset_ += GetTransactionSize(bytes_, size_, offset_);
+       return *this;
+     }
+
+     TransactionIterator operator++(int){
+       auto pos = *this;
+       offset_ += GetTransactionSize(bytes_, size_, offset_);
+       return pos;
+     }
+
+     TransactionIterator& operator=(const TransactionIterator& rhs) = default;
+
+     friend bool operator==(const TransactionIterator& lhs, const TransactionIterator& rhs){
+       return lhs.bytes_ == rhs.bytes_ && lhs.offset_ == rhs.offset_;
+     }
+
+     friend bool operator!=(const TransactionIterator& lhs, const TransactionIterator& rhs){
+       return !operator==(lhs, rhs);
+     }
+   };
+  private:
+   BufferPtr data_;
+   const uint8_t* bytes_;
+   uint64_t offset_; // of the block in data_
+   uint64_t num_transactions_;
+   uint64_t size_; // 0 if the view is invalid
+
+   // the size of the already validated transaction at offset in a block of size bytes
+   static inline uint64_t
+   GetTransactionSize(const uint8_t* bytes, uint64_t size, uint64_t offset){
+     uint64_t num_inputs, num_outputs;
+     auto tx = &bytes[offset + sizeof(UnsignedLong)];
+     return sizeof(UnsignedLong) + TransactionView::Parse(tx, size - offset - sizeof(UnsignedLong), &num_inputs, &num_outputs);
+   }
+  public:
+   BlockView():
+    data_(),
+    bytes_(nullptr),
+    offset_(0),
+    num_transactions_(0),
+    size_(0){
+   }
+   explicit BlockView(const BufferPtr& data, uint64_t offset = 0):
+    data_(data),
+    bytes_(nullptr),
+    offset_(offset),
+    num_transactions_(0),
+    size_(0){
+     if(!data || offset > data->length() || (data->length() - offset) < kHeaderSize){
+       LOG(ERROR) << "cannot view block @" << offset << " in buffer.";
+       return;
+     }
+
+     auto bytes = &data->data()[offset];
+     auto length = data->length() - offset;
+     auto num_transactions = DecodeLittleEndian<UnsignedLong>(&bytes[sizeof(UnsignedLong) + sizeof(RawTimestamp)]);
+     uint64_t pos = kHeaderSize;
+     for(uint64_t idx = 0; idx < num_transactions; idx++){
+       uint64_t num_inputs, num_outputs;
+       uint64_t size = 0;
+       if((length - pos) >= sizeof(UnsignedLong))
+         size = TransactionView::Parse(&bytes[pos + sizeof(UnsignedLong)], length - pos - sizeof(UnsignedLong), &num_inputs, &num_outputs);
+       if(size == 0){
+         LOG(ERROR) << "cannot view transaction #" << idx << " of block @" << offset << " in " << data->ToString() << ".";
+         return;
+       }
+       pos += sizeof(UnsignedLong) + size;
+     }
+     bytes_ = bytes;
+     num_transactions_ = num_transactions;
+     size_ = pos;
+   }
+   BlockView(const BlockView& rhs) = default;
+   ~BlockView() = default;
+
+   bool IsValid() const{
+     return size_ > 0;
+   }
+
+   uint64_t height() const{
+     return DecodeLittleEndian<UnsignedLong>(bytes_);
+   }
+
+   Timestamp timestamp() const{
+     return FromUnixTimestamp(DecodeLittleEndian<UnsignedLong>(&bytes_[sizeof(UnsignedLong)]));
+   }
+
+   uint64_t GetNumberOfTransactions() const{
+     return num_transactions_;
+   }
+
+   // returns an invalid view if idx is out of bounds
+   IndexedTransactionView transactions(uint64_t idx) const{
+     if(idx >= GetNumberOfTransactions()){
+       LOG(ERROR) << "cannot view transaction #" << idx << " of block w/ " << GetNumberOfTransactions() << " transactions.";
+       return IndexedTransactionView();
+     }
+     auto pos = transactions_begin();
+     std::advance(pos, idx);
+     return *pos;
+   }
+
+   TransactionIterator transactions_begin() const{
+     return TransactionIterator(*this, kHeaderSize);
+   }
+
+   TransactionIterator transactions_end() const{
+     return TransactionIterator(*this, size_);
+   }
+
+   const uint8_t* data() const{
+     return bytes_;
+   }
+
+   uint64_t GetBufferSize() const{
+     return size_;
+   }
+
+   uint256 hash() const{
+     return sha256::Of(data(), GetBufferSize());
+   }
+
+   BlockView& operator=(const BlockView& rhs) = default;
+ };
+}
+
+#endif//TOKEN_BLOCK_VIEW_H
@@ -0,0 +1,106 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "token/buffer.h"
+
+namespace token{
+ static inline int
+ GetMadvise(const MappedBuffer::Advice& advice){
+   switch(advice){
+     case MappedBuffer::kSequential:
+       return MADV_SEQUENTIAL;
+     case MappedBuffer::kRandom:
+       return MADV_RANDOM;
+     case MappedBuffer::kNormal:
+     default:
+       return MADV_NORMAL;
+   }
+ }
+
+ MappedBuffer::MappedBuffer(const std::string& filename, const Mode& mode, const Advice& advice, uint64_t length):
+  Buffer(),
+  filename_(filename),
+  mode_(mode),
+  data_(nullptr),
+  length_(0){
+   auto fd = mode == kReadWrite
+           ? open(filename.data(), O_RDWR | O_CREAT, 0644)
+           : open(filename.data(), O_RDONLY);
+   if(fd < 0){
+     LOG(ERROR) << "cannot open file " << filename << ": " << strerror(errno);
+     return;
+   }
+
+   struct stat st;
+   if(fstat(fd, &st) != 0){
+     LOG(ERROR) << "cannot stat file " << filename << ": " << strerror(errno);
+     close(fd);
+     return;
+   }
+
+   auto size = static_cast<uint64_t>(st.st_size);
+   if(length == 0){
+     length = size;
+   } else if(length > size){
+     if(mode != kReadWrite){
+       LOG(ERROR) << "cannot map " << length << " bytes of " << filename << ", the file has " << size << " bytes.";
+       close(fd);
+       return;
+     }
+     if(ftruncate(fd, static_cast<off_t>(length)) != 0){
+       LOG(ERROR) << "cannot extend file " << filename << " to " << length << " bytes: " << strerror(errno);
+       close(fd);
+       return;
+     }
+   }
+
+   if(length == 0){
+     DVLOG(2) << "cannot map an empty file.";
+     close(fd);
+     return;
+   }
+
+   auto data = mode == kReadWrite
+             ? mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+             : mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+   // the mapping keeps its own reference to the file
+   close(fd);
+   if(data == MAP_FAILED){
+     LOG(ERROR) << "cannot map " << length << " bytes of " << filename << ": " << strerror(errno);
+     return;
+   }
+
+   DVLOG(2) << "mapped " << length << " bytes of " << filename;
+   data_ = static_cast<uint8_t*>(data);
+   length_ = length;
+   wpos_ = std::min(length, size);
+   Advise(advice);
+ }
+
+ MappedBuffer::~MappedBuffer(){
+   if(data_ && munmap(data_, length_) != 0)
+     LOG(WARNING) << "cannot unmap " << filename_ << ": " << strerror(errno);
+ }
+
+ bool MappedBuffer::Advise(const Advice& advice){
+   if(!data_)
+     return false;
+   if(madvise(data_, length_, GetMadvise(advice)) != 0){
+     DLOG(WARNING) << "cannot advise mapping of " << filename_ << ": " << strerror(errno);
+     return false;
+   }
+   return true;
+ }
+
+ bool MappedBuffer::Sync(){
+   if(!data_ || mode_ != kReadWrite)
+     return false;
+   if(msync(data_, length_, MS_SYNC) != 0){
+     LOG(ERROR) << "cannot sync " << filename_ << ": " << strerror(errno);
+     return false;
+   }
+   return true;
+ }
+}
@@ -3,6 +3,8 @@
 
 #include <set>
 #include <memory>
+#include <type_traits>
+#include <algorithm>
 #include <vector>
 #include <fstream>
 #include <leveldb/slice.h>
@@ -12,6 +14,7 @@
 #include "token/product.h"
 #include "token/address.h"
 #include "token/platform.h"
+#include "token/buffer_pool.h"
 #include "token/timestamp.h"
 #include "token/transaction_reference.h"
 
@@ -38,11 +41,22 @@ namespace token{
      rpos_(0){
    }
 
+   /**
+    * Called when a write of size bytes does not fit into the remaining space. Implementations
+    * may consume the bytes themselves (e.g. by flushing or growing) and return true.
+    */
+   virtual bool Overflow(const uint8_t* /* bytes */, uint64_t /* size */){
+     return false;
+   }
+
    template<typename T>
    bool Append(T value){
-     if((wpos_ + (uint64_t) sizeof(T)) > length())
-       return false;
-     memcpy(&data()[wpos_], &value, sizeof(T));
+     if((wpos_ + (uint64_t) sizeof(T)) > length()){
+       uint8_t bytes[sizeof(T)];
+       EncodeLittleEndian(bytes, value);
+       return Overflow(bytes, sizeof(T));
+     }
+     EncodeLittleEndian(&data()[wpos_], value);
      wpos_ += sizeof(T);
      return true;
    }
@@ -51,7 +65,7 @@ namespace token{
    bool Insert(T value, uint64_t idx){
      if((idx + (uint64_t) sizeof(T)) > length())
        return false;
-     memcpy(&data()[idx], (uint8_t*) &value, sizeof(T));
+     EncodeLittleEndian(&data()[idx], value);
      wpos_ = idx + sizeof(T);
      return true;
    }
@@ -62,7 +76,7 @@ namespace token{
        LOG(ERROR) << "cannot read " << sizeof(T) << " bytes @" << idx << " from buffer.";
        return T();//TODO: investigate proper result
      }
-     return *(T*) (data() + idx);
+     return DecodeLittleEndian<T>(data() + idx);
    }
 
    template<typename T>
@@ -153,6 +167,8 @@ namespace token{
 
    bool PutBytes(const uint8_t* bytes, uint64_t size){
      if((wpos_ + size) > length()){
+       if(Overflow(bytes, size))
+         return true;
        DLOG(ERROR) << "buffer is too small.";
        return false;
      }
@@ -186,6 +202,65 @@ namespace token{
      return val;
    }
 
+   /**
+    * Unsigned LEB128, 7 bits per byte w/ the high bit set on all but the last byte. Values below
+    * 128 take a single byte, a full uint64_t takes kMaxVarintSize bytes.
+    */
+   static constexpr const uint64_t kMaxVarintSize = 10;
+
+   static inline uint64_t
+   GetVarintSize(uint64_t val){
+     return ((64 - __builtin_clzll(val | 1)) + 6) / 7;
+   }
+
+   bool PutVarint(uint64_t val){
+     uint8_t data[kMaxVarintSize];
+     uint64_t size = 0;
+     while(val >= 0x80){
+       data[size++] = static_cast<uint8_t>(val) | 0x80;
+       val >>= 7;
+     }
+     data[size++] = static_cast<uint8_t>(val);
+     return PutBytes(data, size);
+   }
+
+   bool GetVarint(uint64_t* result){
+     auto remaining = length() - std::min(rpos_, length());
+     auto data = &this->data()[rpos_];
+     if(remaining >= sizeof(uint64_t)){
+       // the terminating byte is the first one w/o the high bit, if it's within the next 8 bytes
+       // the 7 bit groups are packed together w/o looping over the bytes
+       auto word = DecodeLittleEndian(data);
+       auto stops = ~word & 0x8080808080808080ull;
+       if(stops != 0){
+         auto last = __builtin_ctzll(stops);
+         if(last < 63)
+           word &= (1ull << (last + 1)) - 1;
+         word = (word & 0x007F007F007F007Full) | ((word & 0x7F007F007F007F00ull) >> 1);
+         word = (word & 0x00003FFF00003FFFull) | ((word & 0x3FFF00003FFF0000ull) >> 2);
+         word = (word & 0x000000000FFFFFFFull) | ((word & 0x0FFFFFFF00000000ull) >> 4);
+         (*result) = word;
+         rpos_ += (last + 1) / 8;
+         return true;
+       }
+     }
+
+     uint64_t val = 0;
+     for(uint64_t idx = 0; idx < std::min(remaining, kMaxVarintSize); idx++){
+       uint64_t byte = data[idx];
+       if(idx == (kMaxVarintSize - 1) && byte > 1)
+         break;
+       val |= (byte & 0x7F) << (7 * idx);
+       if((byte & 0x80) == 0){
+         (*result) = val;
+         rpos_ += idx + 1;
+         return true;
+       }
+     }
+     DLOG(ERROR) << "cannot read varint @" << rpos_ << " from buffer.";
+     return false;
+   }
+
    template<class T>
    bool PutBytes(const T& val){
      return PutBytes(val.data(), T::kSize);
@@ -232,6 +307,24 @@ namespace token{
      return TransactionReference(hash, index);
    }
 
+   /**
+    * Returns a buffer over length bytes of this one starting at offset, sharing the storage
+    * instead of copying it and keeping this buffer alive. The slice is fully written, reads start
+    * at its beginning. Returns nullptr if the range is out of bounds. This buffer must be owned by
+    * a shared_ptr.
+    */
+   virtual BufferPtr Slice(uint64_t offset, uint64_t length);
+
+   /**
+    * Slices the next length bytes at the read position and skips over them.
+    */
+   BufferPtr ReadSlice(uint64_t length){
+     auto slice = Slice(rpos_, length);
+     if(slice)
+       rpos_ += length;
+     return slice;
+   }
+
    leveldb::Slice AsSlice() const{
      return {(const char*) data(), length()};
    }
@@ -239,7 +332,7 @@ namespace token{
    bool WriteTo(FILE* file) const{
      if(!file)
        return false;
-     if(fwrite(data(), sizeof(uint8_t), GetWritePosition(), file) != 0){
+     if(fwrite(data(), sizeof(uint8_t), GetWritePosition(), file) != GetWritePosition()){
        LOG(FATAL) << "couldn't write buffer of size " << (sizeof(uint8_t) * GetWritePosition()) << "b to file: "
                   << strerror(errno);
        return false;
@@ -247,35 +340,533 @@ namespace token{
      return true;
    }
 
+   // an UnsignedLong count followed by the elements, see Serializer
+   template<typename T>
+   bool PutList(const T* list, uint64_t length);
+   template<typename T>
+   bool GetList(uint64_t* length, T** result);
+
+   /**
+    * Bulk codec for arrays of fixed size records, T provides kSize and the non-virtual
+    *   void WriteRecord(uint8_t* record) const;
+    *   void ReadRecord(const uint8_t* record);
+    * See Writer/Reader, the records are encoded straight into (or decoded straight out of) the
+    * buffer's memory w/ a single bounds check when they fit.
+    */
    template<typename T>
-   bool PutList(const T* list, uint64_t length){//TODO: unit test
-     if(!PutUnsignedLong(length))
+   bool PutRecords(const T* list, uint64_t num_records);
+   template<typename T>
+   bool GetRecords(T* list, uint64_t num_records);
+
+   // same layout as PutList/GetList, an UnsignedLong count followed by the records
+   template<typename T>
+   bool PutRecordList(const T* list, uint64_t num_records);
+   template<typename T>
+   bool GetRecordList(uint64_t* num_records, T** result);
+
+   virtual std::string ToString() const = 0;
+
+   explicit operator leveldb::Slice() const{
+     return AsSlice();
+   }
+
+   Buffer& operator=(const Buffer& other) = default;
+ };
+
+ /**
+  * Non-virtual write cursor. The storage's memory is looked up once, Reserve checks the space for
+  * a whole record and the fields are then stored w/o further checks. A failed Reserve sticks and
+  * is reported once by Commit, which also moves the storage's write position.
+  *
+  *   Writer<> writer(data);
+  *   if(writer.Reserve(sizeof(uint64_t) + uint256::kSize)){
+  *     writer.PutUnsignedLong(height);
+  *     writer.PutHash(hash);
+  *   }
+  *   return writer.Commit();
+  *
+  * When the storage is full, records of up to kScratchSize bytes are staged and handed to
+  * Buffer::PutBytes, so sinks that grow or stream (see Buffer::Overflow) keep working.
+  */
+ template<class Storage = Buffer>
+ class Writer{
+  public:
+   static constexpr const uint64_t kScratchSize = 256;
+  private:
+   Storage* storage_;
+   uint8_t* data_;
+   uint64_t pos_;
+   uint64_t limit_;
+   bool staged_; // data_ points to scratch_
+   bool ok_;
+   uint8_t scratch_[kScratchSize];
+
+   void Load(){
+     data_ = storage_->data();
+     limit_ = storage_->length();
+     pos_ = std::min(storage_->GetWritePosition(), limit_);
+     staged_ = false;
+   }
+
+   bool Flush(){
+     if(!staged_){
+       storage_->SetWritePosition(pos_);
+     } else if(!storage_->PutBytes(scratch_, pos_)){
+       return false;
+     }
+     Load();
+     return true;
+   }
+
+   bool ReserveSlow(uint64_t size){
+     if(!ok_)
+       return false;
+     if(!Flush() || (((pos_ + size) > limit_) && size > kScratchSize)){
+       DLOG(ERROR) << "cannot reserve " << size << " bytes in " << storage_->ToString();
+       ok_ = false;
        return false;
-     std::for_each(&list[0], &list[length], [&](const T& val){
-       val.WriteTo(shared_from_this());
-     });
+     }
+     if((pos_ + size) > limit_){
+       data_ = scratch_;
+       pos_ = 0;
+       limit_ = kScratchSize;
+       staged_ = true;
+     }
      return true;
    }
+  public:
+   explicit Writer(Storage* storage):
+    storage_(storage),
+    data_(nullptr),
+    pos_(0),
+    limit_(0),
+    staged_(false),
+    ok_(true){
+     Load();
+   }
+   explicit Writer(const std::shared_ptr<Storage>& storage):
+    Writer(storage.get()){
+   }
+   Writer(std::shared_ptr<Storage>&& storage) = delete; // doesn't keep the storage alive
+   Writer(const Writer& rhs) = delete;
+   ~Writer() = default;
+
+   bool ok() const{
+     return ok_;
+   }
+
+   inline bool
+   Reserve(uint64_t size){
+     if(ok_ && (pos_ + size) <= limit_)
+       return true;
+     return ReserveSlow(size);
+   }
+
+#define DEFINE_PUT_CURSOR_TYPE(Name) \
+   inline void Put##Name(Name val){ EncodeLittleEndian(&data_[pos_], val); pos_ += sizeof(Name); } \
+   inline void PutUnsigned##Name(Unsigned##Name val){ EncodeLittleEndian(&data_[pos_], val); pos_ += sizeof(Unsigned##Name); }
+   FOR_EACH_BUFFER_TYPE(DEFINE_PUT_CURSOR_TYPE)
+#undef DEFINE_PUT_CURSOR_TYPE
+
+   // the Put functions don't check the space, see Reserve
+   inline void
+   PutBytes(const uint8_t* bytes, uint64_t size){
+     memcpy(&data_[pos_], bytes, size);
+     pos_ += size;
+   }
+
+   inline void
+   PutHash(const uint256& val){
+     PutBytes(val.data(), uint256::kSize);
+   }
+
+   inline void
+   PutTimestamp(const Timestamp& val){
+     PutUnsignedLong(ToUnixTimestamp(val));
+   }
+
+   inline void
+   PutUser(const User& val){
+     PutBytes(val.data(), User::kSize);
+   }
+
+   inline void
+   PutProduct(const Product& val){
+     PutBytes(val.data(), Product::kSize);
+   }
+
+   /**
+    * Checked copy of size bytes, what doesn't fit is handed to Buffer::PutBytes so the size isn't
+    * limited by kScratchSize.
+    */
+   bool Append(const uint8_t* bytes, uint64_t size){
+     if(ok_ && (pos_ + size) <= limit_){
+       PutBytes(bytes, size);
+       return true;
+     }
+     if(!ok_ || !Flush() || !storage_->PutBytes(bytes, size)){
+       DLOG_IF(ERROR, ok_) << "cannot append " << size << " bytes to " << storage_->ToString();
+       ok_ = false;
+       return false;
+     }
+     Load();
+     return true;
+   }
+
+   template<typename T>
+   inline void
+   PutRecord(const T& val){
+     val.WriteRecord(&data_[pos_]);
+     pos_ += T::kSize;
+   }
 
    template<typename T>
-   bool GetList(uint64_t* length, T** result){//TODO: unit test
-     auto total = (*length) = GetUnsignedLong();
-     DVLOG(2) << "parsed list length: " << total;
-     auto data = (*result) = new T[total];
-     for(auto idx = 0; idx < total; idx++)
-       new (&data[idx])T(shared_from_this());
+   bool PutRecords(const T* list, uint64_t num_records){
+     if(ok_ && !staged_ && num_records <= (limit_ - pos_) / T::kSize){
+       for(uint64_t idx = 0; idx < num_records; idx++)
+         list[idx].WriteRecord(&data_[pos_ + (idx * T::kSize)]);
+       pos_ += num_records * T::kSize;
+       return true;
+     }
+
+     for(uint64_t idx = 0; idx < num_records; idx++){
+       if(!Reserve(T::kSize))
+         return false;
+       PutRecord(list[idx]);
+     }
      return true;
    }
 
-   virtual std::string ToString() const = 0;
+   template<typename T>
+   bool PutRecordList(const T* list, uint64_t num_records){
+     if(!Reserve(sizeof(UnsignedLong)))
+       return false;
+     PutUnsignedLong(num_records);
+     return PutRecords(list, num_records);
+   }
 
-   explicit operator leveldb::Slice() const{
-     return AsSlice();
+   bool Commit(){
+     if(ok_ && !Flush())
+       ok_ = false;
+     return ok_;
    }
 
-   Buffer& operator=(const Buffer& other) = default;
+   Writer& operator=(const Writer& rhs) = delete;
+ };
+
+ /**
+  * Non-virtual read cursor, the counterpart of Writer. Require checks the remaining bytes for a
+  * whole record, the Get functions don't. Commit moves the storage's read position.
+  */
+ template<class Storage = Buffer>
+ class Reader{
+  private:
+   Storage* storage_;
+   const uint8_t* data_;
+   uint64_t pos_;
+   uint64_t limit_;
+   bool ok_;
+  public:
+   explicit Reader(Storage* storage):
+    storage_(storage),
+    data_(storage->data()),
+    pos_(0),
+    limit_(storage->length()),
+    ok_(true){
+     pos_ = std::min(storage->GetReadPosition(), limit_);
+   }
+   explicit Reader(const std::shared_ptr<Storage>& storage):
+    Reader(storage.get()){
+   }
+   // reads [pos, limit) of the storage, regardless of its read position
+   Reader(const std::shared_ptr<Storage>& storage, uint64_t pos, uint64_t limit):
+    Reader(storage.get()){
+     limit_ = std::min(limit, limit_);
+     pos_ = std::min(pos, limit_);
+   }
+   Reader(std::shared_ptr<Storage>&& storage) = delete; // doesn't keep the storage alive
+   Reader(const Reader& rhs) = delete;
+   ~Reader() = default;
+
+   bool ok() const{
+     return ok_;
+   }
+
+   uint64_t GetBytesRemaining() const{
+     return limit_ - pos_;
+   }
+
+   inline bool
+   Require(uint64_t size){
+     if(ok_ && size <= GetBytesRemaining())
+       return true;
+     DLOG_IF(ERROR, ok_) << "cannot read " << size << " bytes from " << storage_->ToString();
+     ok_ = false;
+     return false;
+   }
+
+   // for counts that don't fit, count * size might overflow so it's never passed to Require
+   bool Fail(uint64_t count, uint64_t size){
+     DLOG_IF(ERROR, ok_) << "cannot read " << count << " records of " << size << " bytes from " << storage_->ToString();
+     ok_ = false;
+     return false;
+   }
+
+   inline void
+   GetBytes(uint8_t* bytes, uint64_t size){
+     memcpy(bytes, &data_[pos_], size);
+     pos_ += size;
+   }
+
+#define DEFINE_GET_CURSOR_TYPE(Name) \
+   inline Name Get##Name(){ auto val = DecodeLittleEndian<Name>(&data_[pos_]); pos_ += sizeof(Name); return val; } \
+   inline Unsigned##Name GetUnsigned##Name(){ auto val = DecodeLittleEndian<Unsigned##Name>(&data_[pos_]); pos_ += sizeof(Unsigned##Name); return val; }
+   FOR_EACH_BUFFER_TYPE(DEFINE_GET_CURSOR_TYPE)
+#undef DEFINE_GET_CURSOR_TYPE
+
+   inline uint256
+   GetHash(){
+     uint256 val(&data_[pos_], uint256::kSize);
+     pos_ += uint256::kSize;
+     return val;
+   }
+
+   inline Timestamp
+   GetTimestamp(){
+     return FromUnixTimestamp(GetUnsignedLong());
+   }
+
+   inline User
+   GetUser(){
+     User val(&data_[pos_], User::kSize);
+     pos_ += User::kSize;
+     return val;
+   }
+
+   inline Product
+   GetProduct(){
+     Product val(&data_[pos_], Product::kSize);
+     pos_ += Product::kSize;
+     return val;
+   }
+
+   template<typename T>
+   inline void
+   GetRecord(T& val){
+     val.ReadRecord(&data_[pos_]);
+     pos_ += T::kSize;
+   }
+
+   template<typename T>
+   bool GetRecords(T* list, uint64_t num_records){
+     if(!ok_ || num_records > GetBytesRemaining() / T::kSize)
+       return Fail(num_records, T::kSize);
+     for(uint64_t idx = 0; idx < num_records; idx++)
+       list[idx].ReadRecord(&data_[pos_ + (idx * T::kSize)]);
+     pos_ += num_records * T::kSize;
+     return true;
+   }
+
+   // the count is checked against the remaining bytes before anything is allocated
+   template<typename T>
+   bool GetRecordList(uint64_t* num_records, T** result){
+     if(!Require(sizeof(UnsignedLong)))
+       return false;
+     auto total = GetUnsignedLong();
+     if(total > GetBytesRemaining() / T::kSize)
+       return Fail(total, T::kSize);
+     auto data = new T[total];
+     GetRecords(data, total);
+     (*num_records) = total;
+     (*result) = data;
+     return true;
+   }
+
+   bool Commit(){
+     storage_->SetReadPosition(pos_);
+     return ok_;
+   }
+
+   Reader& operator=(const Reader& rhs) = delete;
+ };
+
+ /**
+  * Compile-time serialization traits. Types w/ a constant kSize and WriteRecord/ReadRecord (see
+  * Buffer::PutRecords) are fixed size, arrays of them are sized as count * kFixedSize and encoded
+  * as records. Everything else must provide GetBufferSize and the templated WriteTo(Writer&) and
+  * ReadFrom(Reader&), these are called non-virtually. They can declare the size of their smallest
+  * encoding as kMinSize, ReadList checks counts against it before allocating.
+  */
+ namespace internal{
+  template<class T, class Enable = void>
+  struct MinSize{
+    static constexpr const uint64_t kValue = 1;
+  };
+
+  template<class T>
+  struct MinSize<T, std::void_t<decltype(T::kMinSize)>>{
+    static constexpr const uint64_t kValue = T::kMinSize;
+  };
+ }
+
+ template<class T, class Enable = void>
+ struct Serializer{
+   static constexpr const bool kIsFixedSize = false;
+   static constexpr const uint64_t kMinSize = internal::MinSize<T>::kValue;
+
+   static inline uint64_t
+   GetBufferSize(const T& val){
+     return val.T::GetBufferSize();
+   }
+
+   static inline uint64_t
+   GetBufferSize(const T* list, uint64_t length){
+     uint64_t size = 0;
+     for(uint64_t idx = 0; idx < length; idx++)
+       size += GetBufferSize(list[idx]);
+     return size;
+   }
+
+   template<class Storage>
+   static inline bool
+   Write(Writer<Storage>& writer, const T& val){
+     return val.WriteTo(writer);
+   }
+
+   template<class Storage>
+   static inline bool
+   Read(Reader<Storage>& reader, T& val){
+     return val.ReadFrom(reader);
+   }
+
+   template<class Storage>
+   static bool WriteList(Writer<Storage>& writer, const T* list, uint64_t length){
+     if(!writer.Reserve(sizeof(UnsignedLong)))
+       return false;
+     writer.PutUnsignedLong(length);
+     for(uint64_t idx = 0; idx < length; idx++){
+       if(!Write(writer, list[idx]))
+         return false;
+     }
+     return true;
+   }
+
+   // every element takes at least kMinSize bytes, the count is checked against that before allocating
+   template<class Storage>
+   static bool ReadList(Reader<Storage>& reader, uint64_t* length, T** result){
+     if(!reader.Require(sizeof(UnsignedLong)))
+       return false;
+     auto total = reader.GetUnsignedLong();
+     if(total > reader.GetBytesRemaining() / kMinSize)
+       return reader.Fail(total, kMinSize);
+     auto data = new T[total];
+     for(uint64_t idx = 0; idx < total; idx++){
+       if(!Read(reader, data[idx])){
+         delete[] data;
+         return false;
+       }
+     }
+     (*length) = total;
+     (*result) = data;
+     return true;
+   }
+ };
+
+ template<class T>
+ struct Serializer<T, std::void_t<decltype(T::kSize), decltype(&T::WriteRecord), decltype(&T::ReadRecord)>>{
+   static constexpr const bool kIsFixedSize = true;
+   static constexpr const uint64_t kFixedSize = T::kSize;
+
+   static constexpr uint64_t
+   GetBufferSize(const T& /* val */){
+     return kFixedSize;
+   }
+
+   static constexpr uint64_t
+   GetBufferSize(const T* /* list */, uint64_t length){
+     return length * kFixedSize;
+   }
+
+   template<class Storage>
+   static inline bool
+   Write(Writer<Storage>& writer, const T& val){
+     if(!writer.Reserve(kFixedSize))
+       return false;
+     writer.PutRecord(val);
+     return true;
+   }
+
+   template<class Storage>
+   static inline bool
+   Read(Reader<Storage>& reader, T& val){
+     if(!reader.Require(kFixedSize))
+       return false;
+     reader.GetRecord(val);
+     return true;
+   }
+
+   template<class Storage>
+   static inline bool
+   WriteList(Writer<Storage>& writer, const T* list, uint64_t length){
+     return writer.PutRecordList(list, length);
+   }
+
+   template<class Storage>
+   static inline bool
+   ReadList(Reader<Storage>& reader, uint64_t* length, T** result){
+     return reader.GetRecordList(length, result);
+   }
  };
 
+ // the size of a list as written by Buffer::PutList
+ template<class T>
+ static inline uint64_t
+ GetListBufferSize(const T* list, uint64_t length){
+   return sizeof(UnsignedLong) + Serializer<T>::GetBufferSize(list, length);
+ }
+
+ template<typename T>
+ bool Buffer::PutList(const T* list, uint64_t length){
+   Writer<> writer(this);
+   Serializer<T>::WriteList(writer, list, length);
+   return writer.Commit();
+ }
+
+ template<typename T>
+ bool Buffer::GetList(uint64_t* length, T** result){
+   Reader<> reader(this);
+   Serializer<T>::ReadList(reader, length, result);
+   return reader.Commit();
+ }
+
+ template<typename T>
+ bool Buffer::PutRecords(const T* list, uint64_t num_records){
+   Writer<> writer(this);
+   writer.PutRecords(list, num_records);
+   return writer.Commit();
+ }
+
+ template<typename T>
+ bool Buffer::GetRecords(T* list, uint64_t num_records){
+   Reader<> reader(this);
+   reader.GetRecords(list, num_records);
+   return reader.Commit();
+ }
+
+ template<typename T>
+ bool Buffer::PutRecordList(const T* list, uint64_t num_records){
+   Writer<> writer(this);
+   writer.PutRecordList(list, num_records);
+   return writer.Commit();
+ }
+
+ template<typename T>
+ bool Buffer::GetRecordList(uint64_t* num_records, T** result){
+   Reader<> reader(this);
+   reader.GetRecordList(num_records, result);
+   return reader.Commit();
+ }
+
  template<const long& Size>
  class StackBuffer : public Buffer{
   protected:
@@ -314,13 +905,13 @@ namespace token{
   public:
    AllocatedBuffer():
        AllocatedBuffer(0){}
-   explicit AllocatedBuffer(const uint64_t& length)://TODO: RoundUpPow2(length)
+   explicit AllocatedBuffer(const uint64_t& length):
        Buffer(),
        data_(nullptr),
        length_(length){
      if(length > 0){
        auto size = sizeof(uint8_t) * length;
-       auto data = (uint8_t*) malloc(size);
+       auto data = BufferPool::Allocate(size);
        if(!data){
          DLOG(WARNING) << "cannot allocate internal buffer of size: " << size;
          return;
@@ -337,7 +928,7 @@ namespace token{
    ~AllocatedBuffer() override{
      if(data_){
        DVLOG(2) << "freeing buffer of size " << length_;
-       free(data_);
+       BufferPool::Free(data_, length_);
      }
    }
 
@@ -361,9 +952,293 @@ namespace token{
    AllocatedBuffer& operator=(const AllocatedBuffer& other) = delete;
  };
 
+ class SliceBuffer : public Buffer{
+  private:
+   BufferPtr parent_;
+   uint64_t offset_;
+   uint64_t length_;
+  public:
+   SliceBuffer(const BufferPtr& parent, uint64_t offset, uint64_t length):
+    Buffer(),
+    parent_(parent),
+    offset_(offset),
+    length_(length){
+     wpos_ = length;
+   }
+   SliceBuffer(const SliceBuffer& rhs) = delete;
+   ~SliceBuffer() override = default;
+
+   BufferPtr GetParent() const{
+     return parent_;
+   }
+
+   uint64_t GetOffset() const{
+     return offset_;
+   }
+
+   // the parent's storage may move (e.g. a GrowableBuffer), so it's looked up on every access
+   uint8_t* data() const override{
+     return parent_->data() + offset_;
+   }
+
+   uint64_t length() const override{
+     return length_;
+   }
+
+   // slices of slices point straight into the parent
+   BufferPtr Slice(uint64_t offset, uint64_t length) override{
+     if((offset + length) > length_){
+       DLOG(WARNING) << "cannot slice " << length << " bytes @" << offset << " from " << ToString();
+       return nullptr;
+     }
+     return parent_->Slice(offset_ + offset, length);
+   }
+
+   std::string ToString() const override{
+     std::stringstream ss;
+     ss << "SliceBuffer(";
+     ss << "offset=" << offset_ << ", ";
+     ss << "length=" << length();
+     ss << ")";
+     return ss.str();
+   }
+
+   SliceBuffer& operator=(const SliceBuffer& rhs) = delete;
+ };
+
+ inline BufferPtr Buffer::Slice(uint64_t offset, uint64_t length){
+   if((offset + length) > this->length()){
+     DLOG(WARNING) << "cannot slice " << length << " bytes @" << offset << " from " << ToString();
+     return nullptr;
+   }
+   return std::allocate_shared<SliceBuffer>(BufferPool::Allocator<SliceBuffer>(), shared_from_this(), offset, length);
+ }
+
+ /**
+  * Heap buffer that grows geometrically when a write doesn't fit, so an object can be serialized
+  * in a single pass without computing its size first. The memory stays contiguous, readers and
+  * sockets can use data() as usual; length() is the capacity, GetWritePosition() the size.
+  */
+ class GrowableBuffer : public Buffer{
+  public:
+   static constexpr const uint64_t kDefaultInitialSize = 256;
+  private:
+   uint8_t* data_;
+   uint64_t capacity_;
+   uint64_t allocated_; // size of the pool block behind data_, capacity_ <= allocated_
+
+   bool Resize(uint64_t capacity){
+     auto size = BufferPool::GetAllocationSize(capacity);
+     auto data = BufferPool::Allocate(size);
+     if(!data){
+       DLOG(WARNING) << "cannot resize buffer from " << capacity_ << " to " << capacity << " bytes.";
+       return false;
+     }
+     if(data_){
+       memcpy(data, data_, wpos_);
+       BufferPool::Free(data_, allocated_);
+     }
+     data_ = data;
+     capacity_ = capacity;
+     allocated_ = size;
+     return true;
+   }
+  protected:
+   bool Overflow(const uint8_t* bytes, uint64_t size) override{
+     if(!Reserve(wpos_ + size))
+       return false;
+     memcpy(&data_[wpos_], bytes, size);
+     wpos_ += size;
+     return true;
+   }
+  public:
+   explicit GrowableBuffer(uint64_t initial_size = kDefaultInitialSize):
+    Buffer(),
+    data_(nullptr),
+    capacity_(0),
+    allocated_(0){
+     if(initial_size > 0)
+       Resize(initial_size);
+   }
+   GrowableBuffer(const GrowableBuffer& rhs) = delete;
+   ~GrowableBuffer() override{
+     BufferPool::Free(data_, allocated_);
+   }
+
+   uint8_t* data() const override{
+     return data_;
+   }
+
+   uint64_t length() const override{
+     return capacity_;
+   }
+
+   /**
+    * Makes room for at least capacity bytes, at least doubling the current capacity.
+    */
+   bool Reserve(uint64_t capacity){
+     if(capacity <= capacity_)
+       return true;
+     if(capacity <= allocated_){
+       capacity_ = allocated_;
+       return true;
+     }
+     return Resize(std::max(capacity, capacity_ * 2));
+   }
+
+   /**
+    * Drops the unused capacity, afterwards length() == GetWritePosition() like an exactly sized
+    * AllocatedBuffer. The pool block is kept, so this never copies.
+    */
+   bool ShrinkToFit(){
+     capacity_ = wpos_;
+     return true;
+   }
+
+   std::string ToString() const override{
+     std::stringstream ss;
+     ss << "GrowableBuffer(";
+     ss << "size=" << GetWritePosition() << ", ";
+     ss << "capacity=" << length();
+     ss << ")";
+     return ss.str();
+   }
+
+   GrowableBuffer& operator=(const GrowableBuffer& rhs) = delete;
+ };
+
+ /**
+  * Buffer over a memory-mapped file, so block files and snapshots can be read without copying
+  * them into the heap. The mapped contents count as written, reads start at the beginning of the
+  * file. Writing into a kReadOnly mapping faults; a kReadWrite mapping is shared with the file
+  * and can be flushed to disk w/ Sync().
+  */
+ class MappedBuffer : public Buffer{
+  public:
+   enum Mode{
+     kReadOnly,
+     kReadWrite,
+   };
+
+   enum Advice{
+     kNormal,
+     kSequential,
+     kRandom,
+   };
+  private:
+   std::string filename_;
+   Mode mode_;
+   uint8_t* data_;
+   uint64_t length_;
+  public:
+   /**
+    * Maps length bytes of filename, or the whole file if length is 0. In kReadWrite mode the file
+    * is created if needed and extended to length bytes. Leaves the buffer unallocated on failure.
+    */
+   MappedBuffer(const std::string& filename, const Mode& mode, const Advice& advice, uint64_t length = 0);
+   MappedBuffer(const MappedBuffer& rhs) = delete;
+   ~MappedBuffer() override;
+
+   std::string GetFilename() const{
+     return filename_;
+   }
+
+   Mode GetMode() const{
+     return mode_;
+   }
+
+   uint8_t* data() const override{
+     return data_;
+   }
+
+   uint64_t length() const override{
+     return length_;
+   }
+
+   bool Advise(const Advice& advice);
+   bool Sync();
+
+   std::string ToString() const override{
+     std::stringstream ss;
+     ss << "MappedBuffer(";
+     ss << "filename=" << filename_ << ", ";
+     ss << "length=" << length();
+     ss << ")";
+     return ss.str();
+   }
+
+   MappedBuffer& operator=(const MappedBuffer& rhs) = delete;
+ };
+
+ /**
+  * Write-only sink that streams everything put into it through sha256, so an object can be
+  * hashed without serializing it into a buffer first.
+  */
+ class HashingBuffer : public Buffer{
+  public:
+   static constexpr const uint64_t kDefaultSize = 8 * sha256::internal::kBlockSize;
+  private:
+   sha256::Hasher hasher_;
+   uint8_t data_[kDefaultSize];
+
+   inline void
+   Flush(){
+     hasher_.Update(data_, wpos_);
+     wpos_ = 0;
+   }
+  protected:
+   bool Overflow(const uint8_t* bytes, uint64_t size) override{
+     Flush();
+     if(size >= length()){
+       hasher_.Update(bytes, size);
+       return true;
+     }
+     memcpy(data_, bytes, size);
+     wpos_ = size;
+     return true;
+   }
+  public:
+   HashingBuffer():
+    Buffer(),
+    hasher_(),
+    data_(){
+   }
+   ~HashingBuffer() override = default;
+
+   uint8_t* data() const override{
+     return (uint8_t*) data_;
+   }
+
+   uint64_t length() const override{
+     return kDefaultSize;
+   }
+
+   uint64_t GetBytesWritten() const{
+     return hasher_.length() + wpos_;
+   }
+
+   uint256 GetHash(){
+     Flush();
+     return hasher_.Final();
+   }
+
+   std::string ToString() const override{
+     std::stringstream ss;
+     ss << "HashingBuffer(";
+     ss << "written=" << GetBytesWritten();
+     ss << ")";
+     return ss.str();
+   }
+ };
+
  static inline BufferPtr
  NewBuffer(const uint64_t& length){
-   return std::make_shared<AllocatedBuffer>(length);
+   return std::allocate_shared<AllocatedBuffer>(BufferPool::Allocator<AllocatedBuffer>(), length);
+ }
+
+ static inline std::shared_ptr<GrowableBuffer>
+ NewGrowableBuffer(uint64_t initial_size = GrowableBuffer::kDefaultInitialSize){
+   return std::allocate_shared<GrowableBuffer>(BufferPool::Allocator<GrowableBuffer>(), initial_size);
  }
 
  template<class M>
@@ -398,22 +1273,27 @@ namespace token{
 
  static inline BufferPtr
  NewBufferFromFile(FILE* file, const uint64_t& length){
-   uint8_t data[length];
-   if(fread(data, sizeof(uint8_t), length, file) != length){
+   auto buffer = NewBuffer(length);
+   if(fread(buffer->data(), sizeof(uint8_t), length, file) != length){
      LOG(ERROR) << "cannot read " << length << " bytes from file into buffer.";
      return nullptr;
    }
-   return CopyBufferFrom(data, length);
+   buffer->SetWritePosition(length);
+   return buffer;
+ }
+
+ static inline std::shared_ptr<MappedBuffer>
+ NewMappedBuffer(const std::string& filename, const MappedBuffer::Mode& mode = MappedBuffer::kReadOnly, const MappedBuffer::Advice& advice = MappedBuffer::kSequential, uint64_t length = 0){
+   auto buffer = std::make_shared<MappedBuffer>(filename, mode, advice, length);
+   return buffer->IsUnallocated() ? nullptr : buffer;
  }
 
+ /**
+  * Maps the first length bytes of the file read-only, the contents are parsed in place.
+  */
  static inline BufferPtr
  NewBufferFromFile(const std::string& filename, const uint64_t& length){
-   FILE* file;
-   if(!(file = fopen(filename.data(), "rb"))){
-     LOG(FATAL) << "cannot open file " << filename << ": " << strerror(errno);
-     return nullptr;
-   }
-   return NewBufferFromFile(file, length);
+   return NewMappedBuffer(filename, MappedBuffer::kReadOnly, MappedBuffer::kSequential, length);
  }
 }
 
@@ -0,0 +1,187 @@
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+#include <glog/logging.h>
+
+#include "token/buffer_pool.h"
+
+namespace token{
+ static constexpr const uint64_t kMaxThreadCacheBytesPerClass = 256 * 1024;
+ static constexpr const uint64_t kMaxThreadCacheBlocksPerClass = 256;
+ static constexpr const uint64_t kMaxCentralCacheBytes = 64 * 1024 * 1024;
+
+ static std::atomic<uint64_t> hits_(0);
+ static std::atomic<uint64_t> misses_(0);
+ static std::atomic<uint64_t> resident_bytes_(0);
+ static std::atomic<uint64_t> allocated_bytes_(0);
+
+ static inline uint64_t
+ GetClassSize(uint64_t size_class){
+   return BufferPool::kMinSize << size_class;
+ }
+
+ static inline uint64_t
+ GetMaxThreadCacheBlocks(uint64_t size_class){
+   return std::max<uint64_t>(1, std::min(kMaxThreadCacheBlocksPerClass, kMaxThreadCacheBytesPerClass / GetClassSize(size_class)));
+ }
+
+ static inline void
+ FreeBlocks(std::vector<uint8_t*>& blocks, uint64_t size_class){
+   for(auto& it : blocks)
+     free(it);
+   resident_bytes_.fetch_sub(blocks.size() * GetClassSize(size_class), std::memory_order_relaxed);
+   blocks.clear();
+ }
+
+ class CentralCache{
+  private:
+   std::mutex mutex_;
+   std::vector<uint8_t*> blocks_[BufferPool::kNumberOfSizeClasses];
+   uint64_t bytes_;
+  public:
+   CentralCache():
+    mutex_(),
+    blocks_(),
+    bytes_(0){
+   }
+   ~CentralCache() = default;
+
+   // moves up to count blocks into the thread cache's list
+   bool Acquire(uint64_t size_class, std::vector<uint8_t*>& result, uint64_t count){
+     std::lock_guard<std::mutex> guard(mutex_);
+     auto& blocks = blocks_[size_class];
+     if(blocks.empty())
+       return false;
+     count = std::min<uint64_t>(count, blocks.size());
+     result.insert(result.end(), blocks.end() - count, blocks.end());
+     blocks.resize(blocks.size() - count);
+     bytes_ -= count * GetClassSize(size_class);
+     return true;
+   }
+
+   // takes over the blocks, whatever doesn't fit under kMaxCentralCacheBytes is freed
+   void Release(uint64_t size_class, std::vector<uint8_t*>& blocks){
+     std::vector<uint8_t*> overflow;
+     {
+       std::lock_guard<std::mutex> guard(mutex_);
+       for(auto& it : blocks){
+         if((bytes_ + GetClassSize(size_class)) > kMaxCentralCacheBytes){
+           overflow.push_back(it);
+           continue;
+         }
+         blocks_[size_class].push_back(it);
+         bytes_ += GetClassSize(size_class);
+       }
+     }
+     blocks.clear();
+     FreeBlocks(overflow, size_class);
+   }
+
+   void Trim(){
+     std::lock_guard<std::mutex> guard(mutex_);
+     for(auto idx = 0; idx < BufferPool::kNumberOfSizeClasses; idx++)
+       FreeBlocks(blocks_[idx], idx);
+     bytes_ = 0;
+   }
+ };
+
+ // never destroyed, thread caches may still release into it while the process exits
+ static CentralCache* central_ = new CentralCache();
+
+ class ThreadCache{
+  private:
+   std::vector<uint8_t*> blocks_[BufferPool::kNumberOfSizeClasses];
+  public:
+   ThreadCache() = default;
+   ~ThreadCache(){
+     for(auto idx = 0; idx < BufferPool::kNumberOfSizeClasses; idx++)
+       central_->Release(idx, blocks_[idx]);
+   }
+
+   uint8_t* Allocate(uint64_t size_class){
+     auto& blocks = blocks_[size_class];
+     if(blocks.empty() && !central_->Acquire(size_class, blocks, (GetMaxThreadCacheBlocks(size_class) + 1) / 2))
+       return nullptr;
+     auto data = blocks.back();
+     blocks.pop_back();
+     return data;
+   }
+
+   void Free(uint64_t size_class, uint8_t* data){
+     auto& blocks = blocks_[size_class];
+     blocks.push_back(data);
+     if(blocks.size() <= GetMaxThreadCacheBlocks(size_class))
+       return;
+
+     // keep half, hand the rest to the other threads
+     std::vector<uint8_t*> overflow(blocks.begin() + (blocks.size() / 2), blocks.end());
+     blocks.resize(blocks.size() / 2);
+     central_->Release(size_class, overflow);
+   }
+
+   void Trim(){
+     for(auto idx = 0; idx < BufferPool::kNumberOfSizeClasses; idx++)
+       FreeBlocks(blocks_[idx], idx);
+   }
+ };
+
+ static thread_local ThreadCache thread_cache_;
+
+ uint8_t* BufferPool::Allocate(uint64_t size){
+   if(size == 0)
+     return nullptr;
+   if(size > kMaxSize){
+     auto data = (uint8_t*) malloc(size);
+     if(data)
+       allocated_bytes_.fetch_add(size, std::memory_order_relaxed);
+     return data;
+   }
+
+   auto size_class = GetSizeClass(size);
+   auto data = thread_cache_.Allocate(size_class);
+   if(data != nullptr){
+     hits_.fetch_add(1, std::memory_order_relaxed);
+     resident_bytes_.fetch_sub(GetClassSize(size_class), std::memory_order_relaxed);
+   } else{
+     misses_.fetch_add(1, std::memory_order_relaxed);
+     data = (uint8_t*) malloc(GetClassSize(size_class));
+     if(!data){
+       DLOG(WARNING) << "cannot allocate " << GetClassSize(size_class) << " bytes.";
+       return nullptr;
+     }
+   }
+   allocated_bytes_.fetch_add(GetClassSize(size_class), std::memory_order_relaxed);
+   return data;
+ }
+
+ void BufferPool::Free(uint8_t* data, uint64_t size){
+   if(data == nullptr)
+     return;
+   if(size > kMaxSize){
+     allocated_bytes_.fetch_sub(size, std::memory_order_relaxed);
+     free(data);
+     return;
+   }
+
+   auto size_class = GetSizeClass(size);
+   allocated_bytes_.fetch_sub(GetClassSize(size_class), std::memory_order_relaxed);
+   resident_bytes_.fetch_add(GetClassSize(size_class), std::memory_order_relaxed);
+   thread_cache_.Free(size_class, data);
+ }
+
+ BufferPool::Stats BufferPool::GetStats(){
+   return Stats{
+     hits_.load(std::memory_order_relaxed),
+     misses_.load(std::memory_order_relaxed),
+     resident_bytes_.load(std::memory_order_relaxed),
+     allocated_bytes_.load(std::memory_order_relaxed),
+   };
+ }
+
+ void BufferPool::Trim(){
+   thread_cache_.Trim();
+   central_->Trim();
+ }
+}
@@ -0,0 +1,116 @@
+#ifndef TOKEN_BUFFER_POOL_H
+#define TOKEN_BUFFER_POOL_H
+
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+namespace token{
+ /**
+  * Recycles buffer memory in power-of-two size classes. Every thread keeps a small cache per
+  * class, overflow and underflow go through a shared central cache, so steady-state allocation
+  * and release don't touch malloc or a lock. Allocations larger than kMaxSize bypass the pool.
+  */
+ class BufferPool{
+  public:
+   static constexpr const uint64_t kMinSizeLog2 = 6;
+   static constexpr const uint64_t kMaxSizeLog2 = 20;
+   static constexpr const uint64_t kMinSize = 1 << kMinSizeLog2;
+   static constexpr const uint64_t kMaxSize = 1 << kMaxSizeLog2;
+   static constexpr const uint64_t kNumberOfSizeClasses = kMaxSizeLog2 - kMinSizeLog2 + 1;
+
+   static inline uint64_t
+   GetSizeClass(uint64_t size){
+     if(size <= kMinSize)
+       return 0;
+     return (64 - __builtin_clzll(size - 1)) - kMinSizeLog2;
+   }
+
+   /**
+    * The number of bytes actually reserved for an allocation of size bytes.
+    */
+   static inline uint64_t
+   GetAllocationSize(uint64_t size){
+     if(size == 0 || size > kMaxSize)
+       return size;
+     return kMinSize << GetSizeClass(size);
+   }
+
+   struct Stats{
+     uint64_t hits;
+     uint64_t misses;
+     uint64_t resident_bytes; // cached in the pool, not in use
+     uint64_t allocated_bytes; // in use
+
+     double GetHitRate() const{
+       auto total = hits + misses;
+       return total > 0 ? static_cast<double>(hits) / total : 0.0;
+     }
+
+     friend std::ostream& operator<<(std::ostream& stream, const Stats& val){
+       return stream << "BufferPool::Stats(hits=" << val.hits << ", misses=" << val.misses << ", "
+                     << "resident=" << val.resident_bytes << "b, allocated=" << val.allocated_bytes << "b)";
+     }
+   };
+
+   /**
+    * Stateless allocator on top of the pool, e.g. for std::allocate_shared.
+    */
+   template<class T>
+   struct Allocator{
+     typedef T value_type;
+
+     Allocator() = default;
+     template<class U>
+     Allocator(const Allocator<U>& /* rhs */){
+     }
+
+     T* allocate(size_t n){
+       auto data = Allocate(n * sizeof(T));
+       if(data == nullptr)
+         throw std::bad_alloc();
+       return reinterpret_cast<T*>(data);
+     }
+
+     void deallocate(T* data, size_t n){
+       Free(reinterpret_cast<uint8_t*>(data), n * sizeof(T));
+     }
+
+     template<class U>
+     friend bool operator==(const Allocator& /* lhs */, const Allocator<U>& /* rhs */){
+       return true;
+     }
+
+     template<class U>
+     friend bool operator!=(const Allocator& /* lhs */, const Allocator<U>& /* rhs */){
+       return false;
+     }
+   };
+
+   BufferPool() = delete;
+   BufferPool(const BufferPool& rhs) = delete;
+
+   /**
+    * Returns at least size bytes (see GetAllocationSize), or nullptr if size is 0 or the memory
+    * cannot be allocated.
+    */
+   static uint8_t* Allocate(uint64_t size);
+
+   /**
+    * size must be the size that was passed to Allocate (or its allocation size).
+    */
+   static void Free(uint8_t* data, uint64_t size);
+
+   static Stats GetStats();
+
+   /**
+    * Releases the memory cached by the central cache and by the calling thread.
+    */
+   static void Trim();
+
+   BufferPool& operator=(const BufferPool& rhs) = delete;
+ };
+}
+
+#endif//TOKEN_BUFFER_POOL_H
@@ -1,28 +1,14 @@
-#include <openssl/evp.h>
-#include <openssl/bio.h>
 #include <glog/logging.h>
 
 #include "token/hash.h"
 #include "token/timestamp.h"
+#include "token/sha256_kernels.h"
 
 namespace token{
  std::string BigNumber::HexString() const{
-   static const char *hexDigits = "0123456789ABCDEF";
-
-   // Create a string and give a hint to its final size (twice the size
-   // of the input binary data)
-   std::string hexString;
-   hexString.reserve(size() * 2);
-
-   // Run through the binary data and convert to a hex string
-   std::for_each(
-       const_begin(),
-       const_end(),
-       [&hexString](uint8_t inputByte) {
-         hexString.push_back(hexDigits[inputByte >> 4]);
-         hexString.push_back(hexDigits[inputByte & 0x0F]);
-       });
-   return hexString;
+   std::string result(size() * 2, '\0');
+   hex::Encode(data(), size(), &result[0]);
+   return result;
  }
 
  std::string BigNumber::BinaryString() const{
@@ -42,49 +28,260 @@ namespace token{
  }
 
  namespace sha256{
+  static inline internal::TransformFunction
+  GetTransformFunction(){
+#ifdef ARCHITECTURE_IS_X64
+    static const internal::TransformFunction kTransform = internal::HasShaExtensions()
+                                                        ? &internal::TransformShaNi
+                                                        : &internal::TransformScalar;
+    return kTransform;
+#else
+    return &internal::TransformScalar;
+#endif//ARCHITECTURE_IS_X64
+  }
+
+  void Hasher::Init(){
+    internal::InitializeState(state_);
+    num_pending_ = 0;
+    length_ = 0;
+  }
+
+  void Hasher::Update(const uint8_t* data, uint64_t length){
+    length_ += length;
+    auto transform = GetTransformFunction();
+    if(num_pending_ > 0){
+      auto count = std::min(length, internal::kBlockSize - num_pending_);
+      memcpy(&pending_[num_pending_], data, count);
+      num_pending_ += count;
+      data += count;
+      length -= count;
+      if(num_pending_ < internal::kBlockSize)
+        return;
+      transform(state_, pending_, 1);
+      num_pending_ = 0;
+    }
+
+    auto num_blocks = length / internal::kBlockSize;
+    if(num_blocks > 0){
+      transform(state_, data, num_blocks);
+      data += num_blocks * internal::kBlockSize;
+      length -= num_blocks * internal::kBlockSize;
+    }
+
+    if(length > 0)
+      memcpy(pending_, data, length);
+    num_pending_ = length;
+  }
+
+  uint256 Hasher::Final(){
+    auto nbits = length_ * 8;
+    pending_[num_pending_++] = 0x80;
+    if(num_pending_ > (internal::kBlockSize - sizeof(uint64_t))){
+      memset(&pending_[num_pending_], 0, internal::kBlockSize - num_pending_);
+      GetTransformFunction()(state_, pending_, 1);
+      num_pending_ = 0;
+    }
+    memset(&pending_[num_pending_], 0, internal::kBlockSize - num_pending_);
+    for(auto idx = 1; idx <= sizeof(uint64_t); idx++){
+      pending_[internal::kBlockSize - idx] = static_cast<uint8_t>(nbits);
+      nbits >>= 8;
+    }
+    GetTransformFunction()(state_, pending_, 1);
+
+    uint256 hash;
+    internal::StoreDigest(state_, &hash[0]);
+    Init();
+    return hash;
+  }
+
   uint256 Of(const uint8_t* data, size_t length){
-    EVP_MD_CTX* ctx;
-    if((ctx = EVP_MD_CTX_new()) == nullptr){
-      LOG(ERROR) << "failed to initialize sha256 context.";
-      return {};
+    Hasher hasher;
+    hasher.Update(data, length);
+    return hasher.Final();
+  }
+
+  class PaddedMessage{
+   private:
+    const uint8_t* data_;
+    uint64_t num_full_blocks_;
+    uint64_t num_blocks_;
+    uint8_t tail_[internal::kBlockSize * 2];
+   public:
+    PaddedMessage():
+     data_(nullptr),
+     num_full_blocks_(0),
+     num_blocks_(0),
+     tail_(){
     }
+    PaddedMessage(const uint8_t* data, uint64_t length):
+     data_(data),
+     num_full_blocks_(length / internal::kBlockSize),
+     num_blocks_(0),
+     tail_(){
+      auto remaining = length % internal::kBlockSize;
+      auto num_tail_blocks = (remaining + 1 + sizeof(uint64_t)) <= internal::kBlockSize ? 1 : 2;
+      num_blocks_ = num_full_blocks_ + num_tail_blocks;
 
-    EVP_MD* sha256;
-    if((sha256 = EVP_MD_fetch(nullptr, "SHA256", nullptr)) == nullptr){
-      LOG(ERROR) << "failed to fetch sha256 algorithm.";
-      return {};
+      if(remaining > 0)
+        memcpy(tail_, &data[num_full_blocks_ * internal::kBlockSize], remaining);
+      tail_[remaining] = 0x80;
+      auto nbits = length * 8;
+      auto end = &tail_[num_tail_blocks * internal::kBlockSize];
+      for(auto idx = 1; idx <= sizeof(uint64_t); idx++){
+        *(end - idx) = static_cast<uint8_t>(nbits);
+        nbits >>= 8;
+      }
     }
+    ~PaddedMessage() = default;
 
-    if(!EVP_DigestInit_ex(ctx, sha256, nullptr)){
-      LOG(ERROR) << "failed to initialize sha256 digest.";
-      return {};
+    uint64_t GetNumberOfBlocks() const{
+      return num_blocks_;
     }
 
-    if(!EVP_DigestUpdate(ctx, data, length)){
-      LOG(ERROR) << "failed to update sha256 digest.";
-      return {};
+    const uint8_t* GetBlock(uint64_t idx) const{
+      if(idx < num_full_blocks_)
+        return &data_[idx * internal::kBlockSize];
+      return &tail_[(idx - num_full_blocks_) * internal::kBlockSize];
     }
 
-    auto digest = (uint8_t*) OPENSSL_malloc(EVP_MD_get_size(sha256));
-    uint32_t len = 0;
-    if(!EVP_DigestFinal_ex(ctx, digest, &len)){
-      LOG(ERROR) << "failed to calculate sha256 digest.";
-      return {};
+    void Transform(const internal::TransformFunction& transform, uint32_t* state) const{
+      if(num_full_blocks_ > 0)
+        transform(state, data_, num_full_blocks_);
+      transform(state, tail_, num_blocks_ - num_full_blocks_);
     }
+  };
 
-    uint256 hash(digest, len);
+  static inline void
+  OfSerial(const uint8_t* const* data, const uint64_t* lengths, uint64_t count, uint256* results){
+    auto transform = GetTransformFunction();
+    for(auto idx = 0; idx < count; idx++){
+      uint32_t state[internal::kStateSize];
+      internal::InitializeState(state);
+      PaddedMessage(data[idx], lengths[idx]).Transform(transform, state);
+      internal::StoreDigest(state, &results[idx][0]);
+    }
+  }
 
-    OPENSSL_free(digest);
-    EVP_MD_free(sha256);
-    EVP_MD_CTX_free(ctx);
-    return hash;
+#ifdef ARCHITECTURE_IS_X64
+  static inline void
+  OfBatchAvx2(const uint8_t* const* data, const uint64_t* lengths, uint64_t count, uint256* results){
+    static constexpr const uint64_t kLanes = internal::kAvx2Lanes;
+    // lanes run in lock-step, so group messages of similar length together
+    std::vector<uint64_t> order(count);
+    for(auto idx = 0; idx < count; idx++)
+      order[idx] = idx;
+    std::stable_sort(order.begin(), order.end(), [lengths](uint64_t lhs, uint64_t rhs){
+      return (lengths[lhs] / internal::kBlockSize) < (lengths[rhs] / internal::kBlockSize);
+    });
+
+    PaddedMessage messages[kLanes];
+    const uint8_t* blocks[kLanes];
+    uint32_t states[internal::kStateSize * kLanes];
+    for(uint64_t offset = 0; offset < count; offset += kLanes){
+      auto lanes = std::min(kLanes, count - offset);
+      uint64_t max_blocks = 0;
+      for(auto lane = 0; lane < lanes; lane++){
+        auto idx = order[offset + lane];
+        messages[lane] = PaddedMessage(data[idx], lengths[idx]);
+        max_blocks = std::max(max_blocks, messages[lane].GetNumberOfBlocks());
+      }
+
+      for(auto word = 0; word < internal::kStateSize; word++){
+        for(auto lane = 0; lane < kLanes; lane++)
+          states[(word * kLanes) + lane] = internal::kInitialState[word];
+      }
+
+      for(uint64_t block = 0; block < max_blocks; block++){
+        uint8_t active = 0;
+        for(auto lane = 0; lane < kLanes; lane++){
+          if(lane < lanes && block < messages[lane].GetNumberOfBlocks()){
+            blocks[lane] = messages[lane].GetBlock(block);
+            active |= (1 << lane);
+          } else{
+            blocks[lane] = messages[0].GetBlock(0);
+          }
+        }
+        internal::Transform8WayAvx2(states, blocks, active);
+      }
+
+      for(auto lane = 0; lane < lanes; lane++){
+        uint32_t state[internal::kStateSize];
+        for(auto word = 0; word < internal::kStateSize; word++)
+          state[word] = states[(word * kLanes) + lane];
+        internal::StoreDigest(state, &results[order[offset + lane]][0]);
+      }
+    }
+  }
+#endif//ARCHITECTURE_IS_X64
+
+  void OfBatch(const uint8_t* const* data, const uint64_t* lengths, uint64_t count, uint256* results){
+#ifdef ARCHITECTURE_IS_X64
+    static const bool kUseAvx2 = internal::HasAvx2();
+    if(kUseAvx2)
+      return OfBatchAvx2(data, lengths, count, results);
+#endif//ARCHITECTURE_IS_X64
+    return OfSerial(data, lengths, count, results);
+  }
+
+  std::vector<uint256> OfBatch(const std::vector<leveldb::Slice>& messages){
+    std::vector<const uint8_t*> data;
+    std::vector<uint64_t> lengths;
+    data.reserve(messages.size());
+    lengths.reserve(messages.size());
+    for(auto& it : messages){
+      data.push_back((const uint8_t*) it.data());
+      lengths.push_back(it.size());
+    }
+
+    std::vector<uint256> results(messages.size());
+    OfBatch(data.data(), lengths.data(), messages.size(), results.data());
+    return results;
   }
 
   uint256 Concat(const uint256& lhs, const uint256& rhs){
-    uint8_t data[kDigestSize * 2];
-    memcpy(&data[0], lhs.data(), kDigestSize);
-    memcpy(&data[kDigestSize], rhs.data(), kDigestSize);
-    return Of(data, kDigestSize * 2);
+    return HashPair(lhs, rhs);
+  }
+
+  static inline internal::HashPairFunction
+  GetHashPairFunction(){
+#ifdef ARCHITECTURE_IS_X64
+    static const internal::HashPairFunction kHashPair = internal::HasShaExtensions()
+                                                      ? &internal::HashPairShaNi
+                                                      : &internal::HashPairScalar;
+    return kHashPair;
+#else
+    return &internal::HashPairScalar;
+#endif//ARCHITECTURE_IS_X64
+  }
+
+  uint256 HashPair(const uint256& lhs, const uint256& rhs){
+    uint256 hash;
+    GetHashPairFunction()(lhs.data(), rhs.data(), &hash[0]);
+    return hash;
+  }
+
+  void HashPairs(const uint256* nodes, uint64_t num_pairs, uint256* results){
+    uint64_t idx = 0;
+#ifdef ARCHITECTURE_IS_X64
+    static const bool kUseAvx2 = internal::HasAvx2();
+    if(kUseAvx2){
+      static constexpr const uint64_t kLanes = internal::kAvx2Lanes;
+      const uint8_t* lhs[kLanes];
+      const uint8_t* rhs[kLanes];
+      uint8_t* digests[kLanes];
+      for(; (idx + kLanes) <= num_pairs; idx += kLanes){
+        for(auto lane = 0; lane < kLanes; lane++){
+          lhs[lane] = nodes[(idx + lane) * 2].data();
+          rhs[lane] = nodes[((idx + lane) * 2) + 1].data();
+          digests[lane] = &results[idx + lane][0];
+        }
+        internal::HashPairs8WayAvx2(lhs, rhs, digests);
+      }
+    }
+#endif//ARCHITECTURE_IS_X64
+    auto hash_pair = GetHashPairFunction();
+    for(; idx < num_pairs; idx++)
+      hash_pair(nodes[idx * 2].data(), nodes[(idx * 2) + 1].data(), &results[idx][0]);
   }
 
   uint256 FromHex(const char* data, size_t length){
@@ -97,6 +294,10 @@ namespace token{
     };
 
     uint256 hash;
+    if(length >= uint256::kHexSize && hex::Decode(data, uint256::kHexSize, &hash[0]))
+      return hash;
+
+    hash.clear();
     for(auto pos = 0; ((pos < (hash.size() * 2)) && (pos < length)); pos += 2){
       uint8_t idx0 = ((uint8_t) data[pos + 0] & 0x1F) ^ 0x10;
       uint8_t idx1 = ((uint8_t) data[pos + 1] & 0x1F) ^ 0x10;
@@ -7,12 +7,15 @@
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <vector>
 #include <sstream>
 #include <unordered_set>
 #include <openssl/sha.h>
 #include <leveldb/slice.h>
 
+#include "token/hex.h"
 #include "token/platform.h"
+#include "token/sha256_kernels.h"
 
 namespace token{
  using random_bytes_engine = std::independent_bits_engine<std::default_random_engine, CHAR_BIT, uint8_t>;
@@ -74,10 +77,27 @@ namespace token{
  class uint256 : public Hash<UINT256_SIZE>{
   public:
    static constexpr const uint64_t kSize = UINT256_SIZE;
+   static constexpr const uint64_t kHexSize = kSize * 2;
+
+   static constexpr const uint64_t kNumberOfWords = kSize / sizeof(uint64_t);
 
    static inline int
    Compare(const uint256& lhs, const uint256& rhs){
-     return memcmp(lhs.data(), rhs.data(), kSize);
+     for(auto idx = 0; idx < kNumberOfWords; idx++){
+       auto a = lhs.GetBigEndianWord(idx);
+       auto b = rhs.GetBigEndianWord(idx);
+       if(a != b)
+         return a < b ? -1 : +1;
+     }
+     return 0;
+   }
+
+   static inline bool
+   Equals(const uint256& lhs, const uint256& rhs){
+     uint64_t diff = 0;
+     for(auto idx = 0; idx < kNumberOfWords; idx++)
+       diff |= lhs.GetWord(idx) ^ rhs.GetWord(idx);
+     return diff == 0;
    }
   public:
    uint256() = default;
@@ -97,16 +117,41 @@ namespace token{
      return data_[index];
    }
 
+   // idx-th 64-bit word in native byte order
+   uint64_t GetWord(uint64_t idx) const{
+     uint64_t result;
+     memcpy(&result, &data_[idx * sizeof(uint64_t)], sizeof(result));
+     return result;
+   }
+
+   // idx-th 64-bit word as a big-endian number, so words order the same way as the bytes
+   uint64_t GetBigEndianWord(uint64_t idx) const{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+     return __builtin_bswap64(GetWord(idx));
+#else
+     return GetWord(idx);
+#endif
+   }
+
+   /**
+    * Same as HexString, without allocating or terminating the result.
+    */
+   void ToHex(char (&result)[kHexSize]) const{
+     hex::Encode(data(), kSize, result);
+   }
+
    friend std::ostream& operator<<(std::ostream& stream, const uint256& val){
-     return stream << val.HexString();
+     char result[kHexSize];
+     val.ToHex(result);
+     return stream.write(result, kHexSize);
    }
 
    friend bool operator==(const uint256& lhs, const uint256& rhs){
-     return Compare(lhs, rhs) == 0;
+     return Equals(lhs, rhs);
    }
 
    friend bool operator!=(const uint256& lhs, const uint256& rhs){
-     return Compare(lhs, rhs) != 0;
+     return !Equals(lhs, rhs);
    }
 
    friend bool operator<(const uint256& lhs, const uint256& rhs){
@@ -124,15 +169,83 @@ namespace token{
 
   static const uint64_t kDefaultNonceSize = 1024;
 
+  class Hasher{
+   private:
+    uint32_t state_[internal::kStateSize];
+    uint8_t pending_[internal::kBlockSize];
+    uint64_t num_pending_;
+    uint64_t length_;
+   public:
+    Hasher():
+     state_(),
+     pending_(),
+     num_pending_(0),
+     length_(0){
+      Init();
+    }
+    Hasher(const Hasher& rhs) = default;
+    ~Hasher() = default;
+
+    uint64_t length() const{
+      return length_;
+    }
+
+    void Init();
+    void Update(const uint8_t* data, uint64_t length);
+
+    /**
+     * Finishes the digest and resets the hasher so it can be reused.
+     */
+    uint256 Final();
+
+    Hasher& operator=(const Hasher& rhs) = default;
+  };
+
   uint256 Of(const uint8_t* data, size_t length);
+
+  /**
+   * Hashes count independent messages at once, writing the digest of data[idx] into results[idx].
+   */
+  void OfBatch(const uint8_t* const* data, const uint64_t* lengths, uint64_t count, uint256* results);
+  std::vector<uint256> OfBatch(const std::vector<leveldb::Slice>& messages);
+
   uint256 Nonce(uint64_t size = kDefaultNonceSize);
   uint256 Concat(const uint256& lhs, const uint256& rhs);
+
+  /**
+   * Equivalent to Concat, using a kernel specialized for 64-byte messages.
+   */
+  uint256 HashPair(const uint256& lhs, const uint256& rhs);
+
+  /**
+   * Hashes adjacent pairs, results[idx] = HashPair(nodes[idx * 2], nodes[(idx * 2) + 1]).
+   */
+  void HashPairs(const uint256* nodes, uint64_t num_pairs, uint256* results);
   uint256 FromHex(const char* data, size_t length);
 
   static inline uint256
   FromHex(const std::string& data){
     return FromHex(data.data(), data.length());
   }
+
+  /**
+   * Unlike FromHex, fails unless data is exactly uint256::kHexSize hex digits.
+   */
+  static inline bool
+  ParseHex(const char* data, size_t length, uint256& result){
+    return length == uint256::kHexSize
+        && hex::Decode(data, length, &result[0]);
+  }
+
+  static inline bool
+  ParseHex(const char (&data)[uint256::kHexSize], uint256& result){
+    return hex::Decode(data, uint256::kHexSize, &result[0]);
+  }
+
+  static inline bool
+  ParseHex(const std::string& data, uint256& result){
+    return ParseHex(data.data(), data.length(), result);
+  }
  }
 
 // typedef std::vector<Hash> HashList;
@@ -152,4 +265,16 @@ namespace token{
 // }
 }
 
+namespace std{
+ // digests are already uniform, folding the words is enough; the multiply spreads values that only
+ // differ in a few bits (counters, masked prefixes) across the result
+ template<>
+ struct hash<token::uint256>{
+   size_t operator()(const token::uint256& val) const{
+     auto folded = val.GetWord(0) ^ val.GetWord(1) ^ val.GetWord(2) ^ val.GetWord(3);
+     return static_cast<size_t>(folded * 0x9E3779B97F4A7C15ull);
+   }
+ };
+}
+
 #endif //TOKEN_HASH_H
\ No newline at end of file
@@ -0,0 +1,184 @@
+#include "token/hex.h"
+
+#ifdef ARCHITECTURE_IS_X64
+#include <immintrin.h>
+#endif//ARCHITECTURE_IS_X64
+
+namespace token::hex{
+ namespace internal{
+  static const char kDigits[] = "0123456789ABCDEF";
+  static constexpr const uint8_t kInvalid = 0xFF;
+
+  struct DecodeTable{
+    uint8_t values[256];
+
+    constexpr DecodeTable():
+     values(){
+      for(auto idx = 0; idx < 256; idx++)
+        values[idx] = kInvalid;
+      for(auto idx = 0; idx < 10; idx++)
+        values['0' + idx] = idx;
+      for(auto idx = 0; idx < 6; idx++){
+        values['A' + idx] = 10 + idx;
+        values['a' + idx] = 10 + idx;
+      }
+    }
+  };
+
+  static constexpr const DecodeTable kDecodeTable;
+
+  void EncodeScalar(const uint8_t* data, uint64_t length, char* result){
+    for(uint64_t idx = 0; idx < length; idx++){
+      result[(idx * 2) + 0] = kDigits[data[idx] >> 4];
+      result[(idx * 2) + 1] = kDigits[data[idx] & 0x0F];
+    }
+  }
+
+  bool DecodeScalar(const char* data, uint64_t length, uint8_t* result){
+    if((length % 2) != 0)
+      return false;
+    for(uint64_t idx = 0; idx < length; idx += 2){
+      auto hi = kDecodeTable.values[static_cast<uint8_t>(data[idx + 0])];
+      auto lo = kDecodeTable.values[static_cast<uint8_t>(data[idx + 1])];
+      if((hi | lo) == kInvalid)
+        return false;
+      result[idx / 2] = static_cast<uint8_t>((hi << 4) | lo);
+    }
+    return true;
+  }
+
+#ifdef ARCHITECTURE_IS_X64
+#define SSSE3_TARGET __attribute__((target("ssse3")))
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+  // the nibbles of every byte are looked up w/ pshufb and interleaved back into char order
+  SSSE3_TARGET uint64_t EncodeSsse3(const uint8_t* data, uint64_t length, char* result){
+    const __m128i digits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kDigits));
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    uint64_t idx = 0;
+    for(; (idx + 16) <= length; idx += 16){
+      auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&data[idx]));
+      auto hi = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(bytes, 4), mask));
+      auto lo = _mm_shuffle_epi8(digits, _mm_and_si128(bytes, mask));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(&result[idx * 2]), _mm_unpacklo_epi8(hi, lo));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(&result[(idx * 2) + 16]), _mm_unpackhi_epi8(hi, lo));
+    }
+    return idx;
+  }
+
+  // maps 16 chars to their nibble values, invalid chars clear their bit in the returned mask
+  static SSSE3_TARGET inline __m128i
+  DecodeNibbles(__m128i chars, int* valid){
+    auto lower = _mm_or_si128(chars, _mm_set1_epi8(0x20));
+    auto digit = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), chars));
+    auto alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('f' + 1), lower));
+    (*valid) = _mm_movemask_epi8(_mm_or_si128(digit, alpha));
+    return _mm_or_si128(_mm_and_si128(digit, _mm_sub_epi8(chars, _mm_set1_epi8('0'))),
+                        _mm_and_si128(alpha, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10))));
+  }
+
+  SSSE3_TARGET uint64_t DecodeSsse3(const char* data, uint64_t length, uint8_t* result, bool* valid){
+    // each pair of nibbles (hi, lo) becomes hi * 16 + lo
+    const __m128i weights = _mm_set1_epi16(0x0110);
+    uint64_t idx = 0;
+    for(; (idx + 32) <= length; idx += 32){
+      int valid0, valid1;
+      auto n0 = DecodeNibbles(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&data[idx])), &valid0);
+      auto n1 = DecodeNibbles(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&data[idx + 16])), &valid1);
+      if((valid0 & valid1) != 0xFFFF){
+        (*valid) = false;
+        return idx / 2;
+      }
+      auto bytes = _mm_packus_epi16(_mm_maddubs_epi16(n0, weights), _mm_maddubs_epi16(n1, weights));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(&result[idx / 2]), bytes);
+    }
+    (*valid) = true;
+    return idx / 2;
+  }
+
+  AVX2_TARGET uint64_t EncodeAvx2(const uint8_t* data, uint64_t length, char* result){
+    const __m256i digits = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(kDigits)));
+    const __m256i mask = _mm256_set1_epi8(0x0F);
+    uint64_t idx = 0;
+    for(; (idx + 32) <= length; idx += 32){
+      auto bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&data[idx]));
+      auto hi = _mm256_shuffle_epi8(digits, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), mask));
+      auto lo = _mm256_shuffle_epi8(digits, _mm256_and_si256(bytes, mask));
+      // unpack works within 128-bit lanes, so the halves have to be put back in order
+      auto first = _mm256_unpacklo_epi8(hi, lo);
+      auto second = _mm256_unpackhi_epi8(hi, lo);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(&result[idx * 2]), _mm256_permute2x128_si256(first, second, 0x20));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(&result[(idx * 2) + 32]), _mm256_permute2x128_si256(first, second, 0x31));
+    }
+    return idx;
+  }
+
+  static AVX2_TARGET inline __m256i
+  DecodeNibbles(__m256i chars, int* valid){
+    auto lower = _mm256_or_si256(chars, _mm256_set1_epi8(0x20));
+    auto digit = _mm256_and_si256(_mm256_cmpgt_epi8(chars, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), chars));
+    auto alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('f' + 1), lower));
+    (*valid) = _mm256_movemask_epi8(_mm256_or_si256(digit, alpha));
+    return _mm256_or_si256(_mm256_and_si256(digit, _mm256_sub_epi8(chars, _mm256_set1_epi8('0'))),
+                           _mm256_and_si256(alpha, _mm256_sub_epi8(lower, _mm256_set1_epi8('a' - 10))));
+  }
+
+  AVX2_TARGET uint64_t DecodeAvx2(const char* data, uint64_t length, uint8_t* result, bool* valid){
+    const __m256i weights = _mm256_set1_epi16(0x0110);
+    uint64_t idx = 0;
+    for(; (idx + 64) <= length; idx += 64){
+      int valid0, valid1;
+      auto n0 = DecodeNibbles(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&data[idx])), &valid0);
+      auto n1 = DecodeNibbles(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&data[idx + 32])), &valid1);
+      if((valid0 & valid1) != -1){
+        (*valid) = false;
+        return idx / 2;
+      }
+      // packus also works within 128-bit lanes
+      auto bytes = _mm256_packus_epi16(_mm256_maddubs_epi16(n0, weights), _mm256_maddubs_epi16(n1, weights));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(&result[idx / 2]), _mm256_permute4x64_epi64(bytes, 0xD8));
+    }
+    (*valid) = true;
+    return idx / 2;
+  }
+
+#undef SSSE3_TARGET
+#undef AVX2_TARGET
+#endif//ARCHITECTURE_IS_X64
+ }
+
+ void Encode(const uint8_t* data, uint64_t length, char* result){
+   uint64_t idx = 0;
+#ifdef ARCHITECTURE_IS_X64
+   static const bool kUseAvx2 = internal::HasAvx2();
+   static const bool kUseSsse3 = internal::HasSsse3();
+   if(kUseAvx2)
+     idx += internal::EncodeAvx2(data, length, result);
+   if(kUseSsse3)
+     idx += internal::EncodeSsse3(&data[idx], length - idx, &result[idx * 2]);
+#endif//ARCHITECTURE_IS_X64
+   internal::EncodeScalar(&data[idx], length - idx, &result[idx * 2]);
+ }
+
+ bool Decode(const char* data, uint64_t length, uint8_t* result){
+   if((length % 2) != 0)
+     return false;
+   uint64_t idx = 0;
+#ifdef ARCHITECTURE_IS_X64
+   static const bool kUseAvx2 = internal::HasAvx2();
+   static const bool kUseSsse3 = internal::HasSsse3();
+   bool valid = true;
+   if(kUseAvx2){
+     idx += internal::DecodeAvx2(data, length, result, &valid) * 2;
+     if(!valid)
+       return false;
+   }
+   if(kUseSsse3){
+     idx += internal::DecodeSsse3(&data[idx], length - idx, &result[idx / 2], &valid) * 2;
+     if(!valid)
+       return false;
+   }
+#endif//ARCHITECTURE_IS_X64
+   return internal::DecodeScalar(&data[idx], length - idx, &result[idx / 2]);
+ }
+}
@@ -0,0 +1,47 @@
+#ifndef TOKEN_HEX_H
+#define TOKEN_HEX_H
+
+#include <cstdint>
+
+#include "token/platform.h"
+
+namespace token::hex{
+ /**
+  * Writes the upper case hex encoding of length bytes, result must have room for length * 2 chars
+  * and is not terminated.
+  */
+ void Encode(const uint8_t* data, uint64_t length, char* result);
+
+ /**
+  * Decodes length chars (either case) into length / 2 bytes. Returns false if length is odd or a
+  * char isn't a hex digit, the contents of result are unspecified in that case.
+  */
+ bool Decode(const char* data, uint64_t length, uint8_t* result);
+
+ namespace internal{
+  void EncodeScalar(const uint8_t* data, uint64_t length, char* result);
+  bool DecodeScalar(const char* data, uint64_t length, uint8_t* result);
+
+#ifdef ARCHITECTURE_IS_X64
+  // 16 bytes <-> 32 chars per step, the tail is left to the scalar kernel
+  static inline bool
+  HasSsse3(){
+    return cpu::HasFeatures(cpu::kSsse3);
+  }
+
+  uint64_t EncodeSsse3(const uint8_t* data, uint64_t length, char* result);
+  uint64_t DecodeSsse3(const char* data, uint64_t length, uint8_t* result, bool* valid);
+
+  // 32 bytes <-> 64 chars per step
+  static inline bool
+  HasAvx2(){
+    return cpu::HasFeatures(cpu::kAvx2);
+  }
+
+  uint64_t EncodeAvx2(const uint8_t* data, uint64_t length, char* result);
+  uint64_t DecodeAvx2(const char* data, uint64_t length, uint8_t* result, bool* valid);
+#endif//ARCHITECTURE_IS_X64
+ }
+}
+
+#endif//TOKEN_HEX_H
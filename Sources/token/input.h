@@ -36,7 +36,11 @@ namespace token{
     source_(hash, index){
    }
    explicit Input(const BufferPtr& data):
-    Input(data->GetTransactionReference()){
+    source_(){
+     Reader<> reader(data);
+     if(reader.Require(kSize))
+       reader.GetRecord(*this);
+     reader.Commit();
    }
    Input(const Input& rhs) = default;
    ~Input() override = default;
@@ -54,7 +58,18 @@ namespace token{
    }
 
    bool WriteTo(const BufferPtr& data) const override{
-     return data->PutTransactionReference(source_);
+     Writer<> writer(data);
+     if(writer.Reserve(kSize))
+       writer.PutRecord(*this);
+     return writer.Commit();
+   }
+
+   void WriteRecord(uint8_t* record) const{
+     source_.WriteRecord(record);
+   }
+
+   void ReadRecord(const uint8_t* record){
+     source_.ReadRecord(record);
    }
 
    Input& operator=(const Input& rhs) = default;
@@ -1,54 +1,362 @@
+#include <algorithm>
+
 #include "token/common.h"
 #include "token/merkle.h"
+#include "token/worker_pool.h"
 
 namespace token::merkle{
  Node* Tree::BuildTree(std::vector<Node*>& nodes){
    if(nodes.size() == 1)
      return nodes.front();
+
+   std::vector<uint256> children;
+   children.reserve(nodes.size() + 1);
+   for(auto& it : nodes)
+     children.push_back(it->hash());
+   if((children.size() % 2) == 1)
+     children.push_back(children.back());
+
+   std::vector<uint256> hashes(children.size() / 2);
+   sha256::HashPairs(children.data(), hashes.size(), hashes.data());
+
    std::vector<Node*> parents;
-   for(auto idx = 0; idx < nodes.size(); idx += 2)
-     parents.push_back(new Node(nodes[idx], nodes[idx + 1]));
+   parents.reserve(hashes.size());
+   for(auto idx = 0; idx < hashes.size(); idx++){
+     auto left = nodes[idx * 2];
+     auto right = ((idx * 2) + 1) < nodes.size() ? nodes[(idx * 2) + 1] : nullptr;
+     auto parent = new Node(left, right, hashes[idx]);
+     Index(parent);
+     parents.push_back(parent);
+   }
    return BuildTree(parents);
  }
 
  Node* Tree::BuildTree(std::vector<uint256>& leaves){
+   if(leaves.empty())
+     return nullptr;
    std::vector<Node*> nodes;
-   for(auto& it : leaves)
-     nodes.push_back(new Node(it));
-   if((nodes.size() % 2) == 1)
-     nodes.push_back(nodes.back());//TODO: should we make a copy of this?
+   nodes.reserve(leaves.size());
+   leaves_.reserve(leaves.size());
+   for(auto& it : leaves){
+     auto leaf = new Node(it);
+     Index(leaf);
+     nodes.push_back(leaf);
+   }
+   leaves_ = nodes;
+   if(nodes.size() == 1){
+     auto root = new Node(nodes.front(), nullptr);
+     Index(root);
+     return root;
+   }
    return BuildTree(nodes);
  }
 
- const Node* Tree::Search(const Node* root, const uint256& hash) const{
-   if(root == nullptr || root->hash() == hash)
-     return root;
-   auto node = Search(root->left(), hash);
-   if(node != nullptr)
-     return node;
-   node = Search(root->right(), hash);
-   return node;
+ const Node* Tree::GetNode(const uint256& hash) const{
+   auto range = index_.equal_range(hash);
+   for(auto it = range.first; it != range.second; it++){
+     if(it->second->IsLeaf())
+       return it->second;
+   }
+   return range.first != range.second ? range.first->second : nullptr;
  }
 
- const Node* Tree::GetNode(const uint256& hash) const{
-   return Search(root(), hash);
+ void Tree::Unindex(Node* node){
+   auto range = index_.equal_range(node->hash());
+   for(auto it = range.first; it != range.second; it++){
+     if(it->second == node){
+       index_.erase(it);
+       return;
+     }
+   }
+ }
+
+ bool Tree::UpdateLeaves(const std::vector<LeafUpdate>& updates){
+   for(auto& it : updates){
+     if(it.first >= GetNumberOfLeaves()){
+       LOG(WARNING) << "cannot update leaf #" << it.first << ", tree has " << GetNumberOfLeaves() << " leaves.";
+       return false;
+     }
+   }
+
+   // every leaf is at the same depth, so the dirty nodes can be rehashed a level at a time
+   std::vector<Node*> dirty;
+   dirty.reserve(updates.size());
+   for(auto& it : updates){
+     auto leaf = leaves_[it.first];
+     Unindex(leaf);
+     leaf->SetHash(it.second);
+     Index(leaf);
+     if(leaf->HasParent())
+       dirty.push_back(leaf->parent());
+   }
+
+   while(!dirty.empty()){
+     std::sort(dirty.begin(), dirty.end());
+     dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+
+     std::vector<Node*> parents;
+     parents.reserve(dirty.size());
+     for(auto& it : dirty){
+       Unindex(it);
+       it->SetHash(it->ComputeHash());
+       Index(it);
+       if(it->HasParent())
+         parents.push_back(it->parent());
+     }
+     dirty.swap(parents);
+   }
+   return true;
+ }
+
+ class HashPairsTask : public Task{
+  private:
+   const uint256* children_;
+   uint64_t num_pairs_;
+   uint256* parents_;
+  public:
+   HashPairsTask(const uint256* children, uint64_t num_pairs, uint256* parents):
+    Task(),
+    children_(children),
+    num_pairs_(num_pairs),
+    parents_(parents){
+   }
+   ~HashPairsTask() override = default;
+
+   void Run() override{
+     sha256::HashPairs(children_, num_pairs_, parents_);
+   }
+ };
+
+ FlatTree::FlatTree(const std::vector<uint256>& leaves, WorkerPool* pool):
+  nodes_(),
+  levels_(){
+   if(leaves.empty())
+     return;
+
+   // a single leaf still gets a parent, see Tree
+   uint64_t size = leaves.size();
+   uint64_t total = size;
+   levels_.push_back(0);
+   do{
+     size = (size + 1) / 2;
+     levels_.push_back(total);
+     total += size;
+   } while(size > 1);
+   levels_.push_back(total);
+
+   nodes_.resize(total);
+   std::copy(leaves.begin(), leaves.end(), nodes_.begin());
+   for(auto level = 1; level < GetNumberOfLevels(); level++)
+     BuildLevel(level, pool);
+ }
+
+ void FlatTree::BuildLevel(uint64_t level, WorkerPool* pool){
+   auto children = &nodes_[levels_[level - 1]];
+   auto num_children = GetLevelSize(level - 1);
+   auto parents = &nodes_[levels_[level]];
+   auto num_pairs = num_children / 2;
+   if(pool != nullptr && pool->GetNumberOfWorkers() > 0 && num_pairs >= (2 * kMinPairsPerTask)){
+     auto num_tasks = std::min((pool->GetNumberOfWorkers() + 1) * 4, num_pairs / kMinPairsPerTask);
+     auto pairs_per_task = (num_pairs + num_tasks - 1) / num_tasks;
+
+     std::vector<HashPairsTask> tasks;
+     tasks.reserve(num_tasks);
+     for(uint64_t offset = 0; offset < num_pairs; offset += pairs_per_task)
+       tasks.emplace_back(&children[offset * 2], std::min(pairs_per_task, num_pairs - offset), &parents[offset]);
+
+     std::vector<Task*> batch;
+     batch.reserve(tasks.size());
+     for(auto& it : tasks)
+       batch.push_back(&it);
+     pool->RunAll(batch);
+   } else{
+     sha256::HashPairs(children, num_pairs, parents);
+   }
+
+   if((num_children % 2) == 1)
+     parents[num_children / 2] = sha256::HashPair(children[num_children - 1], children[num_children - 1]);
+ }
+
+ bool FlatTree::UpdateLeaves(const std::vector<Tree::LeafUpdate>& updates){
+   for(auto& it : updates){
+     if(it.first >= GetNumberOfLeaves()){
+       LOG(WARNING) << "cannot update leaf #" << it.first << ", tree has " << GetNumberOfLeaves() << " leaves.";
+       return false;
+     }
+   }
+
+   std::vector<uint64_t> dirty;
+   dirty.reserve(updates.size());
+   for(auto& it : updates){
+     nodes_[it.first] = it.second;
+     dirty.push_back(it.first);
+   }
+
+   for(auto level = 1; level < GetNumberOfLevels(); level++){
+     for(auto& it : dirty)
+       it /= 2;
+     std::sort(dirty.begin(), dirty.end());
+     dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+
+     auto children = &nodes_[levels_[level - 1]];
+     auto num_children = GetLevelSize(level - 1);
+     auto parents = &nodes_[levels_[level]];
+     for(auto& it : dirty){
+       auto left = it * 2;
+       auto right = (left + 1) < num_children ? left + 1 : left;
+       parents[it] = sha256::HashPair(children[left], children[right]);
+     }
+   }
+   return true;
+ }
+
+ bool FlatTree::GetProof(uint64_t leaf, Proof& proof) const{
+   proof.Clear();
+   if(leaf >= GetNumberOfLeaves())
+     return false;
+
+   auto idx = leaf;
+   for(auto level = 0; level < (GetNumberOfLevels() - 1); level++){
+     auto sibling = idx ^ 1;
+     if(sibling >= GetLevelSize(level))
+       sibling = idx;
+     if(!proof.Append(GetNode(level, sibling), sibling < idx))
+       return false;
+     idx /= 2;
+   }
+   return true;
+ }
+
+ bool Tree::GetProof(const uint256& leaf, Proof& proof) const{
+   proof.Clear();
+   auto node = GetNode(leaf);
+   if(node == nullptr || !node->IsLeaf())
+     return false;
+
+   while(node->HasParent()){
+     auto parent = node->parent();
+     if(parent->left() == node){
+       if(!proof.Append(parent->HasRight() ? parent->right()->hash() : node->hash(), false))
+         return false;
+     } else{
+       if(!proof.Append(parent->left()->hash(), true))
+         return false;
+     }
+     node = parent;
+   }
+   return true;
+ }
+
+ class NodeCollector : public NodeVisitor{
+  private:
+   std::vector<uint256>& hashes_;
+  public:
+   explicit NodeCollector(std::vector<uint256>& hashes):
+    NodeVisitor(),
+    hashes_(hashes){
+   }
+   ~NodeCollector() override = default;
+
+   void Visit(const Node& node) const override{
+     hashes_.push_back(node.hash());
+   }
+ };
+
+ static void
+ VisitPreOrder(const Node* node, NodeVisitor* vis, bool leaves_only){
+   if(node == nullptr)
+     return;
+   if(!leaves_only || node->IsLeaf())
+     vis->Visit(*node);
+   VisitPreOrder(node->left(), vis, leaves_only);
+   VisitPreOrder(node->right(), vis, leaves_only);
  }
 
  bool Tree::GetNodes(std::vector<uint256>& hashes) const{
-   NOT_IMPLEMENTED(FATAL);//TODO: implement
-   return false;
+   NodeCollector collector(hashes);
+   VisitNodes(&collector);
+   return true;
  }
 
  bool Tree::GetLeaves(std::vector<uint256>& hashes) const{
-   NOT_IMPLEMENTED(FATAL);//TODO: implement
-   return false;
+   NodeCollector collector(hashes);
+   VisitLeaves(&collector);
+   return true;
  }
 
  void Tree::VisitNodes(NodeVisitor* vis) const{
-   NOT_IMPLEMENTED(FATAL);//TODO: implement
+   VisitPreOrder(root(), vis, false);
  }
 
  void Tree::VisitLeaves(NodeVisitor* vis) const{
-   NOT_IMPLEMENTED(FATAL);//TODO: implement
+   VisitPreOrder(root(), vis, true);
+ }
+
+ void Accumulator::Append(const uint256& leaf){
+   auto carry = leaf;
+   auto level = 0;
+   while((size_ & (static_cast<uint64_t>(1) << level)) != 0){
+     carry = sha256::HashPair(frontier_[level], carry);
+     level++;
+   }
+   if(level >= frontier_.size())
+     frontier_.resize(level + 1);
+   frontier_[level] = carry;
+   size_++;
+ }
+
+ uint256 Accumulator::GetRootHash() const{
+   if(empty())
+     return uint256();
+   if(size_ == 1)
+     return sha256::HashPair(frontier_[0], frontier_[0]);
+
+   // carry is the last node of the current level whenever that node covers an incomplete subtree
+   uint256 carry;
+   bool has_carry = false;
+   for(auto level = 0; ; level++){
+     auto has_node = (size_ & (static_cast<uint64_t>(1) << level)) != 0;
+     auto level_size = ((size_ - 1) >> level) + 1;
+     if(level_size == 1)
+       return has_carry ? carry : frontier_[level];
+
+     if(has_carry){
+       carry = has_node ? sha256::HashPair(frontier_[level], carry) : sha256::HashPair(carry, carry);
+     } else if(has_node){
+       carry = sha256::HashPair(frontier_[level], frontier_[level]);
+       has_carry = true;
+     }
+   }
+ }
+
+ Proof::Proof(const BufferPtr& buff):
+  path_(buff->GetUnsignedLong()),
+  siblings_(){
+   auto depth = buff->GetUnsignedLong();
+   if(depth > kMaxDepth){
+     LOG(WARNING) << "cannot decode proof w/ depth " << depth << " (max " << kMaxDepth << ").";
+     path_ = 0;
+     return;
+   }
+   siblings_.reserve(depth);
+   for(auto idx = 0; idx < depth; idx++)
+     siblings_.push_back(buff->GetHash());
+ }
+
+ uint256 Proof::ComputeRoot(const uint256& leaf) const{
+   auto hash = leaf;
+   for(auto idx = 0; idx < GetDepth(); idx++)
+     hash = IsLeftSibling(idx) ? sha256::HashPair(GetSibling(idx), hash) : sha256::HashPair(hash, GetSibling(idx));
+   return hash;
+ }
+
+ bool Proof::WriteTo(const BufferPtr& buff) const{
+   if(!buff->PutUnsignedLong(path()) || !buff->PutUnsignedLong(GetDepth()))
+     return false;
+   for(auto& it : siblings_){
+     if(!buff->PutHash(it))
+       return false;
+   }
+   return true;
  }
 }
\ No newline at end of file
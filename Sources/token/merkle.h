@@ -1,7 +1,14 @@
 #ifndef TOKEN_MERKLE_H
 #define TOKEN_MERKLE_H
 
+#include <unordered_map>
+
 #include "token/hash.h"
+#include "token/buffer.h"
+
+namespace token{
+ class WorkerPool;
+}
 
 namespace token::merkle{
  class Node;
@@ -13,7 +20,9 @@ namespace token::merkle{
    virtual void Visit(const Node& node) const = 0;
  };
 
+ class Tree;
  class Node{
+   friend class Tree;
   protected:
    Node* parent_;
    Node* lchild_;
@@ -32,6 +41,11 @@ namespace token::merkle{
        node->SetParent(this);
    }
 
+   inline void
+   SetHash(const uint256& hash){
+     hash_ = hash;
+   }
+
    inline void
    SetRight(Node* node){
      rchild_ = node;
@@ -42,7 +56,7 @@ namespace token::merkle{
    uint256 ComputeHash() const{
      if(IsLeaf())
        return hash_;
-     return sha256::Concat(left()->hash(), right()->hash());
+     return sha256::HashPair(left()->hash(), HasRight() ? right()->hash() : left()->hash());
    }
   public:
    Node() = delete;
@@ -55,8 +69,13 @@ namespace token::merkle{
    explicit Node(const uint256& hash):
     Node(nullptr, hash){
    }
+   Node(Node* left, Node* right, const uint256& hash):
+    Node(nullptr, hash){
+     SetLeft(left);
+     SetRight(right);
+   }
    Node(Node* parent, Node* left, Node* right):
-    Node(parent, sha256::Concat(left->hash(), right->hash())){
+    Node(parent, sha256::HashPair(left->hash(), right ? right->hash() : left->hash())){
      SetLeft(left);
      SetRight(right);
    }
@@ -108,13 +127,13 @@ namespace token::merkle{
    bool VerifyHash() const{
      if(IsLeaf())
        return true;
-     if(!HasRight())
-       return hash() == left()->hash();
      return hash() == ComputeHash();
    }
 
    int GetLeaves() const{
-     return IsLeaf() ? 1 : left()->GetLeaves() + right()->GetLeaves();
+     if(IsLeaf())
+       return 1;
+     return left()->GetLeaves() + (HasRight() ? right()->GetLeaves() : 0);
    }
 
    Node& operator=(const Node& rhs) = delete;
@@ -140,16 +159,116 @@ namespace token::merkle{
    }
  };
 
+ /**
+  * Audit path from a leaf to the root, ordered bottom-up. Bit i of path() is set when the i-th
+  * sibling is the left operand of its pair.
+  */
+ class Proof{
+  public:
+   static constexpr const uint64_t kMaxDepth = 64;
+  private:
+   uint64_t path_;
+   std::vector<uint256> siblings_;
+  public:
+   Proof():
+    path_(0),
+    siblings_(){
+   }
+   explicit Proof(const BufferPtr& buff);
+   Proof(const Proof& rhs) = default;
+   ~Proof() = default;
+
+   uint64_t path() const{
+     return path_;
+   }
+
+   uint64_t GetDepth() const{
+     return siblings_.size();
+   }
+
+   const uint256& GetSibling(uint64_t idx) const{
+     return siblings_[idx];
+   }
+
+   bool IsLeftSibling(uint64_t idx) const{
+     return (path_ & (static_cast<uint64_t>(1) << idx)) != 0;
+   }
+
+   bool Append(const uint256& sibling, bool left){
+     if(GetDepth() >= kMaxDepth)
+       return false;
+     if(left)
+       path_ |= (static_cast<uint64_t>(1) << GetDepth());
+     siblings_.push_back(sibling);
+     return true;
+   }
+
+   void Clear(){
+     path_ = 0;
+     siblings_.clear();
+   }
+
+   /**
+    * Hashes the leaf up the audit path.
+    */
+   uint256 ComputeRoot(const uint256& leaf) const;
+
+   uint64_t GetBufferSize() const{
+     return sizeof(uint64_t) + sizeof(uint64_t) + (GetDepth() * uint256::kSize);
+   }
+
+   bool WriteTo(const BufferPtr& buff) const;
+
+   Proof& operator=(const Proof& rhs) = default;
+
+   friend bool operator==(const Proof& lhs, const Proof& rhs){
+     return lhs.path() == rhs.path()
+         && lhs.siblings_ == rhs.siblings_;
+   }
+
+   friend bool operator!=(const Proof& lhs, const Proof& rhs){
+     return !operator==(lhs, rhs);
+   }
+
+   friend std::ostream& operator<<(std::ostream& stream, const Proof& val){
+     return stream << "Proof(depth=" << val.GetDepth() << ", path=" << std::hex << val.path() << std::dec << ")";
+   }
+ };
+
+ static inline bool
+ VerifyProof(const uint256& root, const uint256& leaf, const Proof& proof){
+   return proof.GetDepth() > 0
+       && proof.ComputeRoot(leaf) == root;
+ }
+
+ /**
+  * A level with an odd number of nodes pairs its last node with itself, the duplicate is not stored
+  * so that node has no right child. A tree with a single leaf hashes that leaf with itself.
+  */
  class Tree{
   private:
+   typedef std::unordered_multimap<uint256, Node*> NodeIndex;
+
    Node* root_;
+   std::vector<Node*> leaves_;
+   NodeIndex index_;
 
-   const Node* Search(const Node* root, const uint256& hash) const;
+   void Index(Node* node){
+     index_.emplace(node->hash(), node);
+   }
+
+   void Unindex(Node* node);
    Node* BuildTree(std::vector<Node*>& leaves);
    Node* BuildTree(std::vector<uint256>& leaves);
   public:
+   typedef std::pair<uint64_t, uint256> LeafUpdate;
+
    Tree(std::vector<uint256>& leaves):
-    root_(BuildTree(leaves)){
+    root_(nullptr),
+    leaves_(),
+    index_(){
+     index_.reserve(leaves.size() * 2);
+     root_ = BuildTree(leaves);
    }
    virtual ~Tree(){
      if(root_)
@@ -161,18 +280,150 @@ namespace token::merkle{
    }
 
    bool empty() const{
-     return root() != nullptr;
+     return root() == nullptr;
    }
 
    uint256 GetRootHash() const{
-     return root()->hash();
+     return empty() ? uint256() : root()->hash();
+   }
+
+   uint64_t GetNumberOfLeaves() const{
+     return leaves_.size();
+   }
+
+   const Node* GetLeaf(uint64_t idx) const{
+     return leaves_[idx];
    }
 
+   /**
+    * Returns a leaf when one has the given hash, otherwise any node w/ that hash.
+    */
    const Node* GetNode(const uint256& hash) const;
    bool GetNodes(std::vector<uint256>& hashes) const;
    bool GetLeaves(std::vector<uint256>& hashes) const;
    void VisitLeaves(NodeVisitor* vis) const;
    void VisitNodes(NodeVisitor* vis) const;
+   bool GetProof(const uint256& leaf, Proof& proof) const;
+
+   /**
+    * Replaces the given leaves and rehashes only their paths to the root, ancestors shared by
+    * several updates are hashed once. Fails without changing the tree if an index is out of range.
+    */
+   bool UpdateLeaves(const std::vector<LeafUpdate>& updates);
+ };
+
+ /**
+  * Array-backed alternative to Tree, every level is stored back to back in a single allocation
+  * (leaves first, root last) and nodes are addressed by (level, index). Uses the same pairing
+  * rules as Tree, so both produce the same root. There is no lookup by hash, use Tree to search
+  * for nodes.
+  */
+ class FlatTree{
+  private:
+   std::vector<uint256> nodes_;
+   std::vector<uint64_t> levels_; // offset of each level into nodes_, followed by nodes_.size()
+
+   void BuildLevel(uint64_t level, WorkerPool* pool);
+  public:
+   static constexpr const uint64_t kMinPairsPerTask = 1024;
+
+   explicit FlatTree(const std::vector<uint256>& leaves):
+    FlatTree(leaves, nullptr){
+   }
+   /**
+    * Splits every level with at least 2 * kMinPairsPerTask pairs across the pool, the result is
+    * identical to building the tree serially.
+    */
+   FlatTree(const std::vector<uint256>& leaves, WorkerPool* pool);
+   FlatTree(const FlatTree& rhs) = default;
+   ~FlatTree() = default;
+
+   bool empty() const{
+     return nodes_.empty();
+   }
+
+   uint64_t GetNumberOfLevels() const{
+     return levels_.empty() ? 0 : levels_.size() - 1;
+   }
+
+   uint64_t GetLevelSize(uint64_t level) const{
+     return levels_[level + 1] - levels_[level];
+   }
+
+   uint64_t GetNumberOfLeaves() const{
+     return empty() ? 0 : GetLevelSize(0);
+   }
+
+   uint64_t GetNumberOfNodes() const{
+     return nodes_.size();
+   }
+
+   const uint256& GetNode(uint64_t level, uint64_t idx) const{
+     return nodes_[levels_[level] + idx];
+   }
+
+   const uint256& GetLeaf(uint64_t idx) const{
+     return GetNode(0, idx);
+   }
+
+   uint256 GetRootHash() const{
+     return empty() ? uint256() : nodes_.back();
+   }
+
+   bool GetProof(uint64_t leaf, Proof& proof) const;
+
+   /**
+    * See Tree::UpdateLeaves.
+    */
+   bool UpdateLeaves(const std::vector<Tree::LeafUpdate>& updates);
+
+   FlatTree& operator=(const FlatTree& rhs) = default;
+ };
+
+ /**
+  * Append-only root computation. Holds the roots of the complete subtrees covering the leaves
+  * appended so far (frontier_[level] is valid when bit level of the leaf count is set), so both
+  * Append and GetRootHash are O(log n). Uses the same pairing rules as Tree.
+  */
+ class Accumulator{
+  private:
+   std::vector<uint256> frontier_;
+   uint64_t size_;
+  public:
+   Accumulator():
+    frontier_(),
+    size_(0){
+   }
+   explicit Accumulator(const std::vector<uint256>& leaves):
+    Accumulator(){
+     Append(leaves);
+   }
+   Accumulator(const Accumulator& rhs) = default;
+   ~Accumulator() = default;
+
+   uint64_t GetNumberOfLeaves() const{
+     return size_;
+   }
+
+   bool empty() const{
+     return size_ == 0;
+   }
+
+   void Append(const uint256& leaf);
+
+   void Append(const std::vector<uint256>& leaves){
+     for(auto& it : leaves)
+       Append(it);
+   }
+
+   void Clear(){
+     frontier_.clear();
+     size_ = 0;
+   }
+
+   uint256 GetRootHash() const;
+
+   Accumulator& operator=(const Accumulator& rhs) = default;
  };
 }
 
@@ -8,6 +8,8 @@ namespace token{
      LOG(FATAL) << "couldn't open file " << filename << " for writing: " << strerror(errno);
      return false;
    }
-   return data->WriteTo(file);
+   auto result = data->WriteTo(file);
+   fclose(file);
+   return result;
  }
 }
\ No newline at end of file
@@ -4,6 +4,9 @@
 #include "buffer.h"
 
 namespace token{
+ // leads the compact (varint) encodings of top level objects, see Transaction::WriteCompactTo
+ static constexpr const uint64_t kCompactEncodingVersion = 1;
+
  enum Type{
    kBlock,
    kInput,
@@ -30,27 +33,55 @@ namespace token{
 
     bool WriteTo(const std::string& filename) const;
 
+    // serializes in a single pass, GetBufferSize() is only used as the initial capacity
     BufferPtr ToBuffer() const{
-      auto data = NewBuffer(GetBufferSize());
-      if(!WriteTo(data))
+      auto data = NewGrowableBuffer(GetBufferSize());
+      if(!WriteTo(data) || !data->ShrinkToFit())
         return nullptr;//TODO: better error handling.
       return data;
     }
   };
 
+  /**
+   * The hash is computed on first use and cached, subclasses must call InvalidateHash whenever
+   * their serialized form changes. Sharing an object between threads requires calling hash()
+   * once before it is published.
+   */
   class BinaryObject : public SerializableObject{
+   private:
+    mutable uint256 hash_;
+    mutable bool has_hash_;
    protected:
-    BinaryObject() = default;
+    BinaryObject():
+     SerializableObject(),
+     hash_(),
+     has_hash_(false){
+    }
+    BinaryObject(const BinaryObject& rhs) = default;
+
+    void InvalidateHash(){
+      has_hash_ = false;
+    }
+
+    BinaryObject& operator=(const BinaryObject& rhs) = default;
    public:
     ~BinaryObject() override = default;
 
-    uint256 hash() const{
-      auto data = NewBuffer(GetBufferSize());
-      if(!SerializableObject::WriteTo(data)){
-        LOG(FATAL) << "cannot write to buffer.";
+    uint256 ComputeHash() const{
+      auto sink = std::make_shared<HashingBuffer>();
+      if(!WriteTo(sink)){
+        LOG(FATAL) << "cannot write to hashing buffer.";
         return {};
       }
-      return sha256::Of(data->data(), data->length());
+      return sink->GetHash();
+    }
+
+    uint256 hash() const{
+      if(!has_hash_){
+        hash_ = ComputeHash();
+        has_hash_ = true;
+      }
+      return hash_;
     }
   };
 }
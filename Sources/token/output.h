@@ -53,8 +53,12 @@ namespace token{
     Output(User(user), Product(product)){
    }
    explicit Output(const BufferPtr& data):
-    user_(data->GetUser()),
-    product_(data->GetProduct()){
+    user_(),
+    product_(){
+     Reader<> reader(data);
+     if(reader.Require(kSize))
+       reader.GetRecord(*this);
+     reader.Commit();
    }
    Output(const Output& rhs):
     user_(rhs.user()),
@@ -79,8 +83,20 @@ namespace token{
    }
 
    bool WriteTo(const BufferPtr& data) const override{
-     return data->PutUser(user_)
-         && data->PutProduct(product_);
+     Writer<> writer(data);
+     if(writer.Reserve(kSize))
+       writer.PutRecord(*this);
+     return writer.Commit();
+   }
+
+   void WriteRecord(uint8_t* record) const{
+     user_.WriteRecord(record);
+     product_.WriteRecord(&record[User::kSize]);
+   }
+
+   void ReadRecord(const uint8_t* record){
+     user_.ReadRecord(record);
+     product_.ReadRecord(&record[User::kSize]);
    }
 
    Output& operator=(const Output& rhs){
@@ -0,0 +1,107 @@
+#include <utility>
+
+#include "token/platform.h"
+
+#ifdef ARCHITECTURE_IS_X64
+#include <cpuid.h>
+#endif//ARCHITECTURE_IS_X64
+
+#if defined(ARCHITECTURE_IS_ARM64) && defined(OS_IS_LINUX)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+namespace token::cpu{
+#ifdef ARCHITECTURE_IS_X64
+ // the OS must save the ymm/zmm registers on context switches, otherwise AVX is unusable
+ static inline uint64_t
+ GetEnabledRegisterState(){
+   uint32_t eax, edx;
+   __asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+   return (static_cast<uint64_t>(edx) << 32) | eax;
+ }
+
+ static uint64_t
+ DetectFeatures(){
+   uint32_t eax, ebx, ecx, edx;
+   if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+     return 0;
+
+   uint64_t features = 0;
+   if(ecx & bit_SSSE3)
+     features |= kSsse3;
+   if(ecx & bit_SSE4_1)
+     features |= kSse41;
+   if(ecx & bit_SSE4_2)
+     features |= kSse42;
+
+   auto has_xsave = (ecx & bit_OSXSAVE) != 0;
+   auto state = has_xsave ? GetEnabledRegisterState() : 0;
+   auto has_ymm = (state & 0x06) == 0x06;
+   auto has_zmm = (state & 0xE6) == 0xE6;
+
+   if(!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+     return features;
+   if(has_ymm && (ebx & bit_AVX2))
+     features |= kAvx2;
+   if(has_zmm && (ebx & bit_AVX512F) && (ebx & bit_AVX512BW) && (ebx & bit_AVX512VL))
+     features |= kAvx512;
+   if(ebx & bit_SHA)
+     features |= kShaNi;
+   return features;
+ }
+#elif defined(ARCHITECTURE_IS_ARM64) && defined(OS_IS_LINUX)
+ static uint64_t
+ DetectFeatures(){
+   auto hwcap = getauxval(AT_HWCAP);
+   uint64_t features = 0;
+   if(hwcap & HWCAP_CRC32)
+     features |= kArmCrc32;
+   if((hwcap & HWCAP_AES) && (hwcap & HWCAP_PMULL))
+     features |= kArmAes;
+   if(hwcap & HWCAP_SHA2)
+     features |= kArmSha2;
+   return features;
+ }
+#elif defined(ARCHITECTURE_IS_ARM64) && defined(OS_IS_OSX)
+ static uint64_t
+ DetectFeatures(){
+   // every apple silicon core has the crypto & crc extensions
+   return kArmCrc32 | kArmAes | kArmSha2;
+ }
+#else
+ static uint64_t
+ DetectFeatures(){
+   return 0;
+ }
+#endif
+
+ uint64_t GetFeatures(){
+   static const uint64_t kFeatures = DetectFeatures();
+   return kFeatures;
+ }
+
+ std::string GetFeaturesString(uint64_t features){
+   static const std::pair<Feature, const char*> kNames[] = {
+     { kSsse3, "ssse3" },
+     { kSse41, "sse4.1" },
+     { kSse42, "sse4.2" },
+     { kAvx2, "avx2" },
+     { kAvx512, "avx512" },
+     { kShaNi, "sha" },
+     { kArmCrc32, "crc32" },
+     { kArmAes, "aes" },
+     { kArmSha2, "sha2" },
+   };
+
+   std::string result;
+   for(auto& it : kNames){
+     if((features & it.first) == 0)
+       continue;
+     if(!result.empty())
+       result += ' ';
+     result += it.second;
+   }
+   return result;
+ }
+}
@@ -2,7 +2,11 @@
 #define TKN_PLATFORM_H
 
 #include <chrono>
+#include <algorithm>
+#include <type_traits>
+#include <string>
 #include <cstdint>
+#include <cstring>
 
 #if defined(__linux__) || defined(__FreeBSD__)
 #define OS_IS_LINUX 1
@@ -70,6 +74,60 @@ namespace token{
  static constexpr int kBitsPerWord = 1 << kBitsPerWordLog2;
 
  static constexpr uword kUWordOne = 1U;
+
+ // fixed width integers are little endian in all encodings (see Buffer::PutUnsignedLong)
+ template<typename T>
+ static inline void
+ EncodeLittleEndian(uint8_t* data, T val){
+   static_assert(std::is_integral<T>::value, "only integers have a byte order");
+   memcpy(data, &val, sizeof(T));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+   std::reverse(data, data + sizeof(T));
+#endif
+ }
+
+ template<typename T = uint64_t>
+ static inline T
+ DecodeLittleEndian(const uint8_t* data){
+   static_assert(std::is_integral<T>::value, "only integers have a byte order");
+   T val;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+   uint8_t bytes[sizeof(T)];
+   std::reverse_copy(data, data + sizeof(T), bytes);
+   memcpy(&val, bytes, sizeof(T));
+#else
+   memcpy(&val, data, sizeof(T));
+#endif
+   return val;
+ }
+
+ /**
+  * Instruction set extensions detected at runtime (cpuid + xgetbv on x86-64, getauxval on
+  * ARM64 linux), so a single build can pick the best kernel on whichever node it runs on.
+  * Kernels are selected once, usually into a static function pointer.
+  */
+ namespace cpu{
+  enum Feature : uint64_t{
+    kSsse3 = 1 << 0,
+    kSse41 = 1 << 1,
+    kSse42 = 1 << 2, // includes crc32
+    kAvx2 = 1 << 3,
+    kAvx512 = 1 << 4, // F + BW + VL
+    kShaNi = 1 << 5,
+    kArmCrc32 = 1 << 6,
+    kArmAes = 1 << 7, // includes pmull
+    kArmSha2 = 1 << 8,
+  };
+
+  uint64_t GetFeatures();
+
+  static inline bool
+  HasFeatures(uint64_t features){
+    return (GetFeatures() & features) == features;
+  }
+
+  std::string GetFeaturesString(uint64_t features = GetFeatures());
+ }
 }
 
 #endif//TKN_PLATFORM_H
\ No newline at end of file
@@ -53,6 +53,14 @@ namespace token{
    }
    ~Product() = default;
 
+   void WriteRecord(uint8_t* record) const{
+     memcpy(record, data_, kSize);
+   }
+
+   void ReadRecord(const uint8_t* record){
+     memcpy(data_, record, kSize);
+   }
+
    const uint8_t* data() const{
      return data_;
    }
@@ -71,8 +71,11 @@ namespace token{
     AllocBuffer(uv_handle_t* handle, size_t suggested_size, uv_buf_t* buf){
       auto session = (SessionBase*)handle->data;
       DVLOG(1) << "allocating buffer of size " << suggested_size << "b for session: " << session->GetUUID();
-      buf->base = (char*)malloc(512 * internal::kMegabytes);
-      buf->len = suggested_size;
+      // the session owns the read buffer, received messages are sliced out of it w/o copying
+      auto buffer = internal::NewBuffer(suggested_size);
+      session->SetReadBuffer(buffer);
+      buf->base = (char*)buffer->data();
+      buf->len = buffer->length();
     }
 
     static void
@@ -90,6 +93,7 @@ namespace token{
     static void
     OnMessageReceived(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buff){
       auto session = ((SessionType*)stream->data); //TODO: Clean this cast up?
+      auto data = session->ReleaseReadBuffer();
       if(nread == UV_EOF){
         LOG(WARNING) << "client disconnected!";
         return;
@@ -105,7 +109,7 @@ namespace token{
       }
 
       DLOG(INFO) << "nread: " << nread;
-      internal::BufferPtr buffer = internal::CopyBufferFrom((uint8_t *) buff->base, nread);
+      internal::BufferPtr buffer = data->Slice(0, nread);
       session->OnMessageRead(buffer);
     }
 
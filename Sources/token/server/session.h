@@ -27,22 +27,35 @@ namespace token{
 
   class SessionBase{
    protected:
+    // a scatter-gather write, the buffers are kept alive until the write completes
     struct SessionWriteData{
       uv_write_t request;
       SessionBase* session;
-      internal::BufferPtr buffer;
+      std::vector<internal::BufferPtr> buffers;
+      std::vector<uv_buf_t> chunks;
 
-      SessionWriteData(SessionBase* s, uint64_t size):
+      explicit SessionWriteData(SessionBase* s, size_t size = 1):
         request(),
         session(s),
-        buffer(internal::NewBuffer(size)){
+        buffers(),
+        chunks(){
         request.data = this;
+        buffers.reserve(size);
+        chunks.reserve(size);
       }
-      SessionWriteData(SessionBase* s, const internal::BufferPtr& data):
-        request(),
-        session(s),
-        buffer(data){
-        request.data = this;
+
+      void Append(const internal::BufferPtr& buffer){
+        buffers.push_back(buffer);
+        chunks.push_back(uv_buf_init((char*)buffer->data(), static_cast<unsigned int>(buffer->GetWritePosition())));
+      }
+
+      // takes ownership of this request, it's deleted once the write completes or fails
+      static void Write(SessionWriteData* data){
+        int err;
+        if((err = uv_write(&data->request, data->session->GetStream(), data->chunks.data(), data->chunks.size(), &OnMessageSent)) != 0){
+          LOG_SESSION(ERROR, data->session) << "couldn't send " << data->chunks.size() << " buffers: " << uv_strerror(err);
+          delete data;
+        }
       }
     };
    public:
@@ -68,6 +81,7 @@ namespace token{
     uv_loop_t* loop_;
     uv_tcp_t handle_;
     atomic::RelaxedAtomic<State> state_;
+    internal::BufferPtr read_buffer_;
 
     void SetState(const State& state){
       state_ = state;
@@ -102,7 +116,8 @@ namespace token{
       uuid_(uuid),
       loop_(loop),
       handle_(),
-      state_(SessionBase::kDisconnectedState){
+      state_(SessionBase::kDisconnectedState),
+      read_buffer_(){
       handle_.data = this;
       if(loop){
         CHECK_UVRESULT(uv_tcp_init(loop_, &handle_), LOG_SESSION(ERROR, this), "couldn't initialize the session handle");
@@ -114,7 +129,8 @@ namespace token{
       uuid_(),
       loop_(nullptr),
       handle_(),
-      state_(SessionBase::kDisconnectedState){
+      state_(SessionBase::kDisconnectedState),
+      read_buffer_(){
       handle_.data = this;
     }
     virtual ~SessionBase() = default;
@@ -139,13 +155,20 @@ namespace token{
       return (uv_stream_t*)&handle_;
     }
 
+    void SetReadBuffer(const internal::BufferPtr& buffer){
+      read_buffer_ = buffer;
+    }
+
+    internal::BufferPtr ReleaseReadBuffer(){
+      auto buffer = read_buffer_;
+      read_buffer_.reset();
+      return buffer;
+    }
+
     void SendMessage(const std::shared_ptr<MessageBase>& msg){
-      auto data = msg->ToBuffer();
-      auto write = new SessionWriteData(this, data);
-      uv_buf_t buffer;
-      buffer.base = (char*)write->buffer->data();
-      buffer.len = static_cast<size_t>(write->buffer->GetWritePosition());
-      uv_write(&write->request, GetStream(), &buffer, 1, &OnMessageSent);
+      auto data = new SessionWriteData(this);
+      data->Append(msg->ToBuffer());
+      SessionWriteData::Write(data);
     }
 
     virtual void SendMessages(const std::vector<std::shared_ptr<MessageBase>>& messages){
@@ -155,34 +178,16 @@ namespace token{
         return;
       }
 
-      uint64_t total_size = 0;
-      std::for_each(messages.begin(), messages.end(), [&total_size](const std::shared_ptr<MessageBase>& msg){
-        total_size += msg->GetBufferSize();
-      });
-      DLOG(INFO) << "total write size: " << total_size;
-
+      // every message is written from its own buffer, nothing is copied into a combined one
       DVLOG_SESSION(2, this) << "sending " << total_messages << " messages....";
-      auto data = new SessionWriteData(this, total_size);
-      uv_buf_t buffers[total_messages];
-
-      uint64_t offset = 0;
+      auto data = new SessionWriteData(this, total_messages);
       for(size_t idx = 0; idx < total_messages; idx++){
         const std::shared_ptr<MessageBase>& msg = messages[idx];
-        uint64_t msize = msg->GetBufferSize();
-        DVLOG_SESSION(1, this) << "sending message #" << idx << " " << msg->ToString() << " (" << msize << "b)";
         auto msg_buff = msg->ToBuffer();
-        data->buffer->PutBytes(msg_buff);
-
-        DLOG(INFO) << "msize: " << msize;
-        DLOG(INFO) << "buffer length: " << msg_buff->length();
-        DLOG(INFO) << "buffer write pos: " << msg_buff->GetWritePosition();
-        DLOG(INFO) << "offset: " << offset;
-
-        buffers[idx].base = (char*)&data->buffer->data()[offset];
-        buffers[idx].len = msize;
-        offset += msize;
+        DVLOG_SESSION(1, this) << "sending message #" << idx << " " << msg->ToString() << " (" << msg_buff->GetWritePosition() << "b)";
+        data->Append(msg_buff);
       }
-      uv_write(&data->request, GetStream(), buffers, total_messages, &OnMessageSent);
+      SessionWriteData::Write(data);
     }
 
 #define DEFINE_STATE_CHECK(Name) \
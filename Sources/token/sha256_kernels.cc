@@ -0,0 +1,363 @@
+#include "token/sha256_kernels.h"
+
+#include <algorithm>
+
+#ifdef ARCHITECTURE_IS_X64
+#include <immintrin.h>
+#endif//ARCHITECTURE_IS_X64
+
+namespace token::sha256::internal{
+ const uint32_t kInitialState[kStateSize] = {
+   0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+   0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+ };
+
+ const uint32_t kRoundConstants[kNumberOfRounds] = {
+   0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+   0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+   0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+   0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+   0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+   0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+   0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+   0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+ };
+
+ static inline uint32_t
+ RotateRight(uint32_t x, int n){
+   return (x >> n) | (x << (32 - n));
+ }
+
+ // W[t] + K[t] for the second block of a 64-byte message, which is always the same padding block
+ struct PairPaddingSchedule{
+   uint32_t words[kNumberOfRounds];
+
+   constexpr PairPaddingSchedule():
+    words(){
+     uint32_t w[kNumberOfRounds] = {};
+     w[0] = 0x80000000;
+     w[15] = 512;
+     for(auto round = 16; round < kNumberOfRounds; round++){
+       auto w15 = w[round - 15];
+       auto w2 = w[round - 2];
+       auto s0 = ((w15 >> 7) | (w15 << 25)) ^ ((w15 >> 18) | (w15 << 14)) ^ (w15 >> 3);
+       auto s1 = ((w2 >> 17) | (w2 << 15)) ^ ((w2 >> 19) | (w2 << 13)) ^ (w2 >> 10);
+       w[round] = w[round - 16] + s0 + w[round - 7] + s1;
+     }
+     for(auto round = 0; round < kNumberOfRounds; round++)
+       words[round] = w[round] + kRoundConstants[round];
+   }
+ };
+
+ static constexpr const PairPaddingSchedule kPairPadding;
+ static constexpr const uint32_t* kPairPaddingSchedule = kPairPadding.words;
+
+ static inline uint32_t
+ LoadBigEndian32(const uint8_t* data){
+   return (static_cast<uint32_t>(data[0]) << 24)
+        | (static_cast<uint32_t>(data[1]) << 16)
+        | (static_cast<uint32_t>(data[2]) << 8)
+        | (static_cast<uint32_t>(data[3]));
+ }
+
+ static inline void
+ Round(uint32_t& a, uint32_t& b, uint32_t& c, uint32_t& d, uint32_t& e, uint32_t& f, uint32_t& g, uint32_t& h, uint32_t wk){
+   auto t1 = h + (RotateRight(e, 6) ^ RotateRight(e, 11) ^ RotateRight(e, 25)) + ((e & f) ^ (~e & g)) + wk;
+   auto t2 = (RotateRight(a, 2) ^ RotateRight(a, 13) ^ RotateRight(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+   h = g;
+   g = f;
+   f = e;
+   e = d + t1;
+   d = c;
+   c = b;
+   b = a;
+   a = t1 + t2;
+ }
+
+ static inline void
+ CompressScalar(uint32_t* state, const uint32_t* message){
+   uint32_t w[16];
+   uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+   uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+   for(auto round = 0; round < kNumberOfRounds; round++){
+     uint32_t wt;
+     if(round < 16){
+       wt = w[round] = message[round];
+     } else{
+       auto w15 = w[(round - 15) & 0xF];
+       auto w2 = w[(round - 2) & 0xF];
+       auto s0 = RotateRight(w15, 7) ^ RotateRight(w15, 18) ^ (w15 >> 3);
+       auto s1 = RotateRight(w2, 17) ^ RotateRight(w2, 19) ^ (w2 >> 10);
+       wt = w[round & 0xF] = w[round & 0xF] + s0 + w[(round - 7) & 0xF] + s1;
+     }
+     Round(a, b, c, d, e, f, g, h, wt + kRoundConstants[round]);
+   }
+   state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+   state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+ }
+
+ void TransformScalar(uint32_t* state, const uint8_t* blocks, uint64_t num_blocks){
+   uint32_t message[16];
+   while(num_blocks-- > 0){
+     for(auto idx = 0; idx < 16; idx++)
+       message[idx] = LoadBigEndian32(&blocks[idx * 4]);
+     CompressScalar(state, message);
+     blocks += kBlockSize;
+   }
+ }
+
+ void HashPairScalar(const uint8_t* lhs, const uint8_t* rhs, uint8_t* digest){
+   uint32_t message[16];
+   for(auto idx = 0; idx < 8; idx++){
+     message[idx] = LoadBigEndian32(&lhs[idx * 4]);
+     message[idx + 8] = LoadBigEndian32(&rhs[idx * 4]);
+   }
+
+   uint32_t state[kStateSize];
+   InitializeState(state);
+   CompressScalar(state, message);
+
+   uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+   uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+   for(auto round = 0; round < kNumberOfRounds; round++)
+     Round(a, b, c, d, e, f, g, h, kPairPaddingSchedule[round]);
+   state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+   state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+   StoreDigest(state, digest);
+ }
+
+#ifdef ARCHITECTURE_IS_X64
+#define SHA_TARGET __attribute__((target("sha,sse4.1,ssse3")))
+
+ // the sha instructions operate on the state as (ABEF, CDGH)
+ static inline SHA_TARGET void
+ LoadStateShaNi(const uint32_t* state, __m128i& state0, __m128i& state1){
+   __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*) &state[0]), 0xB1);
+   state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*) &state[4]), 0x1B);
+   state0 = _mm_alignr_epi8(tmp, state1, 8);
+   state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+ }
+
+ static inline SHA_TARGET void
+ StoreStateShaNi(uint32_t* state, __m128i state0, __m128i state1){
+   __m128i tmp = _mm_shuffle_epi32(state0, 0x1B);
+   state1 = _mm_shuffle_epi32(state1, 0xB1);
+   _mm_storeu_si128((__m128i*) &state[0], _mm_blend_epi16(tmp, state1, 0xF0));
+   _mm_storeu_si128((__m128i*) &state[4], _mm_alignr_epi8(state1, tmp, 8));
+ }
+
+ static inline SHA_TARGET __m128i
+ LoadMessageShaNi(const uint8_t* data){
+   const __m128i kByteSwapMask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+   return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) data), kByteSwapMask);
+ }
+
+ static inline SHA_TARGET void
+ CompressShaNi(__m128i& state0, __m128i& state1, __m128i* msgs){
+   const __m128i abef = state0;
+   const __m128i cdgh = state1;
+   for(auto group = 0; group < 16; group++){
+     auto& current = msgs[group & 0x3];
+     auto& next = msgs[(group + 1) & 0x3];
+     auto& previous = msgs[(group + 3) & 0x3];
+
+     __m128i msg = _mm_add_epi32(current, _mm_loadu_si128((const __m128i*) &kRoundConstants[group * 4]));
+     state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+     if(group >= 3 && group <= 14){
+       next = _mm_add_epi32(next, _mm_alignr_epi8(current, previous, 4));
+       next = _mm_sha256msg2_epu32(next, current);
+     }
+     msg = _mm_shuffle_epi32(msg, 0x0E);
+     state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+     if(group >= 1 && group <= 12)
+       previous = _mm_sha256msg1_epu32(previous, current);
+   }
+   state0 = _mm_add_epi32(state0, abef);
+   state1 = _mm_add_epi32(state1, cdgh);
+ }
+
+ SHA_TARGET
+ void TransformShaNi(uint32_t* state, const uint8_t* blocks, uint64_t num_blocks){
+   __m128i state0, state1;
+   LoadStateShaNi(state, state0, state1);
+   while(num_blocks-- > 0){
+     __m128i msgs[4];
+     for(auto idx = 0; idx < 4; idx++)
+       msgs[idx] = LoadMessageShaNi(&blocks[idx * 16]);
+     CompressShaNi(state0, state1, msgs);
+     blocks += kBlockSize;
+   }
+   StoreStateShaNi(state, state0, state1);
+ }
+
+ SHA_TARGET
+ void HashPairShaNi(const uint8_t* lhs, const uint8_t* rhs, uint8_t* digest){
+   __m128i state0, state1;
+   LoadStateShaNi(kInitialState, state0, state1);
+
+   __m128i msgs[4] = {
+     LoadMessageShaNi(&lhs[0]),
+     LoadMessageShaNi(&lhs[16]),
+     LoadMessageShaNi(&rhs[0]),
+     LoadMessageShaNi(&rhs[16]),
+   };
+   CompressShaNi(state0, state1, msgs);
+
+   const __m128i abef = state0;
+   const __m128i cdgh = state1;
+   for(auto group = 0; group < 16; group++){
+     __m128i msg = _mm_loadu_si128((const __m128i*) &kPairPaddingSchedule[group * 4]);
+     state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+     msg = _mm_shuffle_epi32(msg, 0x0E);
+     state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+   }
+   state0 = _mm_add_epi32(state0, abef);
+   state1 = _mm_add_epi32(state1, cdgh);
+
+   uint32_t state[kStateSize];
+   StoreStateShaNi(state, state0, state1);
+   StoreDigest(state, digest);
+ }
+#undef SHA_TARGET
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+ static inline AVX2_TARGET __m256i
+ RotateRight8Way(__m256i x, int n){
+   return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+ }
+
+ static inline AVX2_TARGET __m256i
+ ByteSwap8Way(__m256i x){
+   const __m256i kByteSwapMask = _mm256_set_epi8(
+     12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+     12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+   return _mm256_shuffle_epi8(x, kByteSwapMask);
+ }
+
+ // transposes 8 rows of 8 words each into 8 columns
+ static inline AVX2_TARGET void
+ Transpose8x8(__m256i* rows){
+   __m256i t0 = _mm256_unpacklo_epi32(rows[0], rows[1]);
+   __m256i t1 = _mm256_unpackhi_epi32(rows[0], rows[1]);
+   __m256i t2 = _mm256_unpacklo_epi32(rows[2], rows[3]);
+   __m256i t3 = _mm256_unpackhi_epi32(rows[2], rows[3]);
+   __m256i t4 = _mm256_unpacklo_epi32(rows[4], rows[5]);
+   __m256i t5 = _mm256_unpackhi_epi32(rows[4], rows[5]);
+   __m256i t6 = _mm256_unpacklo_epi32(rows[6], rows[7]);
+   __m256i t7 = _mm256_unpackhi_epi32(rows[6], rows[7]);
+
+   __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+   __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+   __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+   __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+   __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+   __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+   __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+   __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+   rows[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+   rows[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+   rows[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+   rows[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+   rows[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+   rows[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+   rows[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+   rows[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+ }
+
+ // loads 8 consecutive message words from each lane, word-major
+ static inline AVX2_TARGET void
+ LoadMessage8Way(__m256i* words, const uint8_t* const* lanes, uint64_t offset){
+   for(auto lane = 0; lane < kAvx2Lanes; lane++)
+     words[lane] = _mm256_loadu_si256((const __m256i*) &lanes[lane][offset]);
+   Transpose8x8(words);
+   for(auto idx = 0; idx < 8; idx++)
+     words[idx] = ByteSwap8Way(words[idx]);
+ }
+
+ static inline AVX2_TARGET void
+ Round8Way(__m256i* s, __m256i wk){
+   auto& a = s[0], & b = s[1], & c = s[2], & d = s[3];
+   auto& e = s[4], & f = s[5], & g = s[6], & h = s[7];
+   auto sigma1 = _mm256_xor_si256(_mm256_xor_si256(RotateRight8Way(e, 6), RotateRight8Way(e, 11)), RotateRight8Way(e, 25));
+   auto choose = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+   auto t1 = _mm256_add_epi32(_mm256_add_epi32(h, sigma1), _mm256_add_epi32(choose, wk));
+   auto sigma0 = _mm256_xor_si256(_mm256_xor_si256(RotateRight8Way(a, 2), RotateRight8Way(a, 13)), RotateRight8Way(a, 22));
+   auto majority = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+   auto t2 = _mm256_add_epi32(sigma0, majority);
+   h = g;
+   g = f;
+   f = e;
+   e = _mm256_add_epi32(d, t1);
+   d = c;
+   c = b;
+   b = a;
+   a = _mm256_add_epi32(t1, t2);
+ }
+
+ // compresses the 16 message words in w into s
+ static inline AVX2_TARGET void
+ Compress8Way(__m256i* s, __m256i* w){
+   __m256i v[kStateSize];
+   std::copy(s, s + kStateSize, v);
+   for(auto round = 0; round < kNumberOfRounds; round++){
+     __m256i wt;
+     if(round < 16){
+       wt = w[round];
+     } else{
+       auto w15 = w[(round - 15) & 0xF];
+       auto w2 = w[(round - 2) & 0xF];
+       auto s0 = _mm256_xor_si256(_mm256_xor_si256(RotateRight8Way(w15, 7), RotateRight8Way(w15, 18)), _mm256_srli_epi32(w15, 3));
+       auto s1 = _mm256_xor_si256(_mm256_xor_si256(RotateRight8Way(w2, 17), RotateRight8Way(w2, 19)), _mm256_srli_epi32(w2, 10));
+       wt = w[round & 0xF] = _mm256_add_epi32(_mm256_add_epi32(w[round & 0xF], s0), _mm256_add_epi32(w[(round - 7) & 0xF], s1));
+     }
+     Round8Way(v, _mm256_add_epi32(wt, _mm256_set1_epi32(static_cast<int>(kRoundConstants[round]))));
+   }
+   for(auto idx = 0; idx < kStateSize; idx++)
+     s[idx] = _mm256_add_epi32(s[idx], v[idx]);
+ }
+
+ AVX2_TARGET
+ void Transform8WayAvx2(uint32_t* states, const uint8_t* const* blocks, uint8_t active_lanes){
+   __m256i w[16];
+   LoadMessage8Way(&w[0], blocks, 0);
+   LoadMessage8Way(&w[8], blocks, 32);
+
+   __m256i previous[kStateSize];
+   __m256i s[kStateSize];
+   for(auto idx = 0; idx < kStateSize; idx++)
+     previous[idx] = s[idx] = _mm256_loadu_si256((const __m256i*) &states[idx * kAvx2Lanes]);
+   Compress8Way(s, w);
+
+   const __m256i kLaneBits = _mm256_set_epi32(0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+   const __m256i mask = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(active_lanes), kLaneBits), kLaneBits);
+   for(auto idx = 0; idx < kStateSize; idx++)
+     _mm256_storeu_si256((__m256i*) &states[idx * kAvx2Lanes], _mm256_blendv_epi8(previous[idx], s[idx], mask));
+ }
+
+ AVX2_TARGET
+ void HashPairs8WayAvx2(const uint8_t* const* lhs, const uint8_t* const* rhs, uint8_t* const* digests){
+   __m256i w[16];
+   LoadMessage8Way(&w[0], lhs, 0);
+   LoadMessage8Way(&w[8], rhs, 0);
+
+   __m256i s[kStateSize];
+   for(auto idx = 0; idx < kStateSize; idx++)
+     s[idx] = _mm256_set1_epi32(static_cast<int>(kInitialState[idx]));
+   Compress8Way(s, w);
+
+   __m256i v[kStateSize];
+   std::copy(s, s + kStateSize, v);
+   for(auto round = 0; round < kNumberOfRounds; round++)
+     Round8Way(v, _mm256_set1_epi32(static_cast<int>(kPairPaddingSchedule[round])));
+   for(auto idx = 0; idx < kStateSize; idx++)
+     s[idx] = _mm256_add_epi32(s[idx], v[idx]);
+
+   Transpose8x8(s);
+   for(auto lane = 0; lane < kAvx2Lanes; lane++)
+     _mm256_storeu_si256((__m256i*) digests[lane], ByteSwap8Way(s[lane]));
+ }
+#undef AVX2_TARGET
+#endif//ARCHITECTURE_IS_X64
+}
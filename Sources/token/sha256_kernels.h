@@ -0,0 +1,73 @@
+#ifndef TOKEN_SHA256_KERNELS_H
+#define TOKEN_SHA256_KERNELS_H
+
+#include <cstdint>
+
+#include "token/platform.h"
+
+namespace token::sha256::internal{
+ static constexpr const uint64_t kBlockSize = 64;
+ static constexpr const uint64_t kStateSize = 8;
+ static constexpr const uint64_t kNumberOfRounds = 64;
+
+ extern const uint32_t kInitialState[kStateSize];
+ extern const uint32_t kRoundConstants[kNumberOfRounds];
+
+ static inline void
+ InitializeState(uint32_t* state){
+   for(auto idx = 0; idx < kStateSize; idx++)
+     state[idx] = kInitialState[idx];
+ }
+
+ static inline void
+ StoreDigest(const uint32_t* state, uint8_t* digest){
+   for(auto idx = 0; idx < kStateSize; idx++){
+     digest[(idx * 4) + 0] = static_cast<uint8_t>(state[idx] >> 24);
+     digest[(idx * 4) + 1] = static_cast<uint8_t>(state[idx] >> 16);
+     digest[(idx * 4) + 2] = static_cast<uint8_t>(state[idx] >> 8);
+     digest[(idx * 4) + 3] = static_cast<uint8_t>(state[idx]);
+   }
+ }
+
+ /**
+  * Compresses num_blocks consecutive 64-byte blocks into a single state.
+  */
+ typedef void (*TransformFunction)(uint32_t* state, const uint8_t* blocks, uint64_t num_blocks);
+
+ void TransformScalar(uint32_t* state, const uint8_t* blocks, uint64_t num_blocks);
+
+ /**
+  * Hashes the 64-byte message lhs || rhs, where both halves are 32-byte digests. The second block
+  * of such a message is constant, so its message schedule is precomputed.
+  */
+ typedef void (*HashPairFunction)(const uint8_t* lhs, const uint8_t* rhs, uint8_t* digest);
+
+ void HashPairScalar(const uint8_t* lhs, const uint8_t* rhs, uint8_t* digest);
+
+#ifdef ARCHITECTURE_IS_X64
+ static constexpr const uint64_t kAvx2Lanes = 8;
+
+ static inline bool
+ HasShaExtensions(){
+   return cpu::HasFeatures(cpu::kShaNi | cpu::kSse41 | cpu::kSsse3);
+ }
+
+ static inline bool
+ HasAvx2(){
+   return cpu::HasFeatures(cpu::kAvx2);
+ }
+
+ void TransformShaNi(uint32_t* state, const uint8_t* blocks, uint64_t num_blocks);
+ void HashPairShaNi(const uint8_t* lhs, const uint8_t* rhs, uint8_t* digest);
+
+ /**
+  * Compresses one block into each of 8 independent states. The states are stored transposed,
+  * word-major: states[(word * kAvx2Lanes) + lane]. Lanes that are not set in active_lanes are
+  * left untouched and their block pointer may be anything readable.
+  */
+ void Transform8WayAvx2(uint32_t* states, const uint8_t* const* blocks, uint8_t active_lanes);
+ void HashPairs8WayAvx2(const uint8_t* const* lhs, const uint8_t* const* rhs, uint8_t* const* digests);
+#endif//ARCHITECTURE_IS_X64
+}
+
+#endif//TOKEN_SHA256_KERNELS_H
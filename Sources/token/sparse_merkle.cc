@@ -0,0 +1,213 @@
+#include <glog/logging.h>
+
+#include "token/sparse_merkle.h"
+
+namespace token::merkle{
+ static inline uint64_t
+ CountBits(const uint256& val){
+   uint64_t count = 0;
+   for(auto idx = 0; idx < uint256::kSize; idx++)
+     count += __builtin_popcount(val[idx]);
+   return count;
+ }
+
+ // the number of leading bits lhs and rhs have in common
+ static inline uint64_t
+ GetCommonPrefixLength(const uint256& lhs, const uint256& rhs){
+   for(auto idx = 0; idx < uint256::kSize; idx++){
+     uint8_t diff = lhs[idx] ^ rhs[idx];
+     if(diff != 0)
+       return (idx * 8) + (__builtin_clz(diff) - 24);
+   }
+   return uint256::kSize * 8;
+ }
+
+ SparseProof::SparseProof(const BufferPtr& buff):
+  bitmap_(buff->GetHash()),
+  siblings_(){
+   auto count = buff->GetUnsignedLong();
+   if(count != CountBits(bitmap_)){
+     LOG(WARNING) << "cannot decode sparse proof w/ " << count << " siblings, bitmap has " << CountBits(bitmap_) << ".";
+     bitmap_ = uint256();
+     return;
+   }
+   siblings_.reserve(count);
+   for(auto idx = 0; idx < count; idx++)
+     siblings_.push_back(buff->GetHash());
+ }
+
+ void SparseProof::Append(uint64_t height, const uint256& sibling){
+   bitmap_[height / 8] |= (1 << (height % 8));
+   siblings_.push_back(sibling);
+ }
+
+ uint256 SparseProof::ComputeRoot(const uint256& key, const uint256& leaf) const{
+   auto hash = leaf;
+   auto next = siblings_.begin();
+   for(auto height = 0; height < kDepth; height++){
+     uint256 sibling;
+     if(HasSibling(height)){
+       if(next == siblings_.end())
+         return uint256();
+       sibling = *next++;
+     } else{
+       sibling = SparseTree::GetEmptyHash(height);
+     }
+     hash = SparseTree::GetBit(key, kDepth - height - 1) ? sha256::HashPair(sibling, hash) : sha256::HashPair(hash, sibling);
+   }
+   return next == siblings_.end() ? hash : uint256();
+ }
+
+ bool SparseProof::WriteTo(const BufferPtr& buff) const{
+   if(!buff->PutHash(bitmap()) || !buff->PutUnsignedLong(GetNumberOfSiblings()))
+     return false;
+   for(auto& it : siblings_){
+     if(!buff->PutHash(it))
+       return false;
+   }
+   return true;
+ }
+
+ uint256 SparseTree::GetEmptyHash(uint64_t height){
+   static const std::vector<uint256> kEmptyHashes = [](){
+     std::vector<uint256> hashes(kDepth + 1);
+     for(auto height = 1; height <= kDepth; height++)
+       hashes[height] = sha256::HashPair(hashes[height - 1], hashes[height - 1]);
+     return hashes;
+   }();
+   return kEmptyHashes[height];
+ }
+
+ uint256 SparseTree::GetKey(const TransactionReference& ref){
+   uint8_t index[sizeof(uint64_t)];
+   for(auto idx = 0; idx < sizeof(uint64_t); idx++)
+     index[idx] = static_cast<uint8_t>(ref.index() >> (8 * (sizeof(uint64_t) - idx - 1)));
+
+   sha256::Hasher hasher;
+   auto hash = ref.hash();
+   hasher.Update(hash.data(), uint256::kSize);
+   hasher.Update(index, sizeof(index));
+   return hasher.Final();
+ }
+
+ uint256 SparseTree::GetRightPrefix(const uint256& prefix, uint64_t height){
+   auto right = prefix;
+   auto idx = kDepth - height;
+   right[idx / 8] |= (0x80 >> (idx % 8));
+   return right;
+ }
+
+ uint256 SparseTree::ComputeHash(uint64_t height, const uint256& prefix, LeafIterator first, LeafIterator last) const{
+   if(std::next(first) == last){
+     auto hash = GetLeafHash(first->first, first->second);
+     for(auto idx = 0; idx < height; idx++){
+       hash = GetBit(first->first, kDepth - idx - 1)
+            ? sha256::HashPair(GetEmptyHash(idx), hash)
+            : sha256::HashPair(hash, GetEmptyHash(idx));
+     }
+     return hash;
+   }
+
+   auto middle = Split(prefix, height);
+   auto right = GetRightPrefix(prefix, height);
+   return sha256::HashPair(GetHash(height - 1, prefix, first, middle), GetHash(height - 1, right, middle, last));
+ }
+
+ uint256 SparseTree::GetHash(uint64_t height, const uint256& prefix, LeafIterator first, LeafIterator last) const{
+   if(first == last)
+     return GetEmptyHash(height);
+
+   NodeId id = { height, prefix };
+   auto pos = cache_.find(id);
+   if(pos != cache_.end())
+     return pos->second;
+   auto hash = ComputeHash(height, prefix, first, last);
+   cache_.emplace(id, hash);
+   return hash;
+ }
+
+ void SparseTree::Invalidate(const uint256& key, uint64_t limit){
+   // the prefix of the next node up only differs in one more cleared bit
+   NodeId id = { 0, key };
+   for(uint64_t height = 0; height < limit; height++){
+     if(height > 0){
+       auto idx = kDepth - height;
+       id.height = height;
+       id.prefix[idx / 8] &= ~(0x80 >> (idx % 8));
+     }
+     cache_.erase(id);
+   }
+ }
+
+ bool SparseTree::Get(const uint256& key, uint256* value) const{
+   auto pos = leaves_.find(key);
+   if(pos == leaves_.end())
+     return false;
+   (*value) = pos->second;
+   return true;
+ }
+
+ void SparseTree::Insert(const uint256& key, const uint256& value){
+   leaves_[key] = value;
+   Invalidate(key);
+ }
+
+ bool SparseTree::Remove(const uint256& key){
+   if(leaves_.erase(key) == 0)
+     return false;
+   Invalidate(key);
+   return true;
+ }
+
+ void SparseTree::Update(const std::vector<Entry>& insertions, const std::vector<uint256>& removals){
+   std::vector<uint256> keys;
+   keys.reserve(insertions.size() + removals.size());
+   for(auto& it : insertions){
+     leaves_[it.first] = it.second;
+     keys.push_back(it.first);
+   }
+   for(auto& it : removals){
+     if(leaves_.erase(it) > 0)
+       keys.push_back(it);
+   }
+
+   // in key order every path shares its top w/ the previous one, which has already been erased
+   std::sort(keys.begin(), keys.end());
+   for(auto idx = 0; idx < keys.size(); idx++){
+     auto limit = idx == 0 ? kDepth + 1 : kDepth - GetCommonPrefixLength(keys[idx - 1], keys[idx]);
+     Invalidate(keys[idx], limit);
+   }
+ }
+
+ uint256 SparseTree::GetRootHash() const{
+   return GetHash(kDepth, uint256(), leaves_.begin(), leaves_.end());
+ }
+
+ bool SparseTree::GetProof(const uint256& key, SparseProof& proof) const{
+   proof.Clear();
+
+   // walk down from the root, the siblings are collected top-down
+   std::vector<std::pair<uint64_t, uint256>> siblings;
+   auto first = leaves_.begin();
+   auto last = leaves_.end();
+   auto prefix = uint256();
+   for(auto height = kDepth; height > 0 && first != last; height--){
+     auto middle = Split(prefix, height);
+     auto right = GetRightPrefix(prefix, height);
+     if(GetBit(key, kDepth - height)){
+       if(first != middle)
+         siblings.emplace_back(height - 1, GetHash(height - 1, prefix, first, middle));
+       first = middle;
+       prefix = right;
+     } else{
+       if(middle != last)
+         siblings.emplace_back(height - 1, GetHash(height - 1, right, middle, last));
+       last = middle;
+     }
+   }
+
+   for(auto it = siblings.rbegin(); it != siblings.rend(); it++)
+     proof.Append(it->first, it->second);
+   return true;
+ }
+}
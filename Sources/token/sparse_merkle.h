@@ -0,0 +1,190 @@
+#ifndef TOKEN_SPARSE_MERKLE_H
+#define TOKEN_SPARSE_MERKLE_H
+
+#include <map>
+#include <unordered_map>
+
+#include "token/hash.h"
+#include "token/buffer.h"
+#include "token/transaction_reference.h"
+
+namespace token::merkle{
+ /**
+  * Audit path through a SparseTree, ordered bottom-up. Siblings that are empty subtrees are not
+  * stored, bit h of bitmap() is set when the sibling at height h is stored.
+  */
+ class SparseProof{
+  public:
+   static constexpr const uint64_t kDepth = uint256::kSize * 8;
+  private:
+   uint256 bitmap_;
+   std::vector<uint256> siblings_;
+  public:
+   SparseProof():
+    bitmap_(),
+    siblings_(){
+   }
+   explicit SparseProof(const BufferPtr& buff);
+   SparseProof(const SparseProof& rhs) = default;
+   ~SparseProof() = default;
+
+   uint256 bitmap() const{
+     return bitmap_;
+   }
+
+   uint64_t GetNumberOfSiblings() const{
+     return siblings_.size();
+   }
+
+   bool HasSibling(uint64_t height) const{
+     return (bitmap_[height / 8] & (1 << (height % 8))) != 0;
+   }
+
+   /**
+    * Siblings must be appended bottom-up, starting at height 0.
+    */
+   void Append(uint64_t height, const uint256& sibling);
+
+   void Clear(){
+     bitmap_ = uint256();
+     siblings_.clear();
+   }
+
+   /**
+    * Hashes the leaf node (see SparseTree::GetLeafHash) of key up the audit path.
+    */
+   uint256 ComputeRoot(const uint256& key, const uint256& leaf) const;
+
+   uint64_t GetBufferSize() const{
+     return uint256::kSize + sizeof(uint64_t) + (GetNumberOfSiblings() * uint256::kSize);
+   }
+
+   bool WriteTo(const BufferPtr& buff) const;
+
+   SparseProof& operator=(const SparseProof& rhs) = default;
+
+   friend bool operator==(const SparseProof& lhs, const SparseProof& rhs){
+     return lhs.bitmap() == rhs.bitmap()
+         && lhs.siblings_ == rhs.siblings_;
+   }
+
+   friend bool operator!=(const SparseProof& lhs, const SparseProof& rhs){
+     return !operator==(lhs, rhs);
+   }
+
+   friend std::ostream& operator<<(std::ostream& stream, const SparseProof& val){
+     return stream << "SparseProof(siblings=" << val.GetNumberOfSiblings() << ")";
+   }
+ };
+
+ /**
+  * Merkle tree over the full 256-bit key space, leaves are addressed by the bits of their key
+  * (most significant first from the root). An absent key is an empty leaf, empty subtrees hash to
+  * a fixed value per height, so only the present leaves are stored. The hashes of subtrees that
+  * hang off a branching node are cached, an update only invalidates the paths of its keys.
+  * GetRootHash and GetProof fill the cache, so a tree must not be read from several threads at
+  * once.
+  */
+ class SparseTree{
+  public:
+   static constexpr const uint64_t kDepth = SparseProof::kDepth;
+
+   typedef std::pair<uint256, uint256> Entry;
+
+   static uint256 GetEmptyHash(uint64_t height);
+
+   static inline uint256
+   GetLeafHash(const uint256& key, const uint256& value){
+     return sha256::HashPair(key, value);
+   }
+
+   static inline bool
+   GetBit(const uint256& key, uint64_t idx){
+     return (key[idx / 8] & (0x80 >> (idx % 8))) != 0;
+   }
+
+   static uint256 GetKey(const TransactionReference& ref);
+  private:
+   struct NodeId{
+     uint64_t height;
+     uint256 prefix;
+
+     friend bool operator==(const NodeId& lhs, const NodeId& rhs){
+       return lhs.height == rhs.height
+           && lhs.prefix == rhs.prefix;
+     }
+   };
+
+   struct NodeIdHasher{
+     size_t operator()(const NodeId& val) const{
+       return std::hash<uint256>()(val.prefix) ^ val.height;
+     }
+   };
+
+   typedef std::map<uint256, uint256> LeafMap;
+   typedef LeafMap::const_iterator LeafIterator;
+
+   LeafMap leaves_;
+   mutable std::unordered_map<NodeId, uint256, NodeIdHasher> cache_; // filled by const reads, see above
+
+   static uint256 GetRightPrefix(const uint256& prefix, uint64_t height);
+
+   LeafIterator Split(const uint256& prefix, uint64_t height) const{
+     return leaves_.lower_bound(GetRightPrefix(prefix, height));
+   }
+
+   uint256 ComputeHash(uint64_t height, const uint256& prefix, LeafIterator first, LeafIterator last) const;
+   uint256 GetHash(uint64_t height, const uint256& prefix, LeafIterator first, LeafIterator last) const;
+   // erases the cached nodes on the path from the leaf of key up to (excl.) height limit
+   void Invalidate(const uint256& key, uint64_t limit = kDepth + 1);
+  public:
+   SparseTree():
+    leaves_(),
+    cache_(){
+   }
+   SparseTree(const SparseTree& rhs) = default;
+   ~SparseTree() = default;
+
+   uint64_t size() const{
+     return leaves_.size();
+   }
+
+   bool empty() const{
+     return leaves_.empty();
+   }
+
+   bool Contains(const uint256& key) const{
+     return leaves_.find(key) != leaves_.end();
+   }
+
+   bool Get(const uint256& key, uint256* value) const;
+   void Insert(const uint256& key, const uint256& value);
+   bool Remove(const uint256& key);
+
+   /**
+    * Applies a block worth of changes, removals are applied after insertions.
+    */
+   void Update(const std::vector<Entry>& insertions, const std::vector<uint256>& removals);
+
+   uint256 GetRootHash() const;
+
+   /**
+    * Works for present (membership) and absent (non-membership) keys alike.
+    */
+   bool GetProof(const uint256& key, SparseProof& proof) const;
+
+   SparseTree& operator=(const SparseTree& rhs) = default;
+ };
+
+ static inline bool
+ VerifyMembership(const uint256& root, const uint256& key, const uint256& value, const SparseProof& proof){
+   return proof.ComputeRoot(key, SparseTree::GetLeafHash(key, value)) == root;
+ }
+
+ static inline bool
+ VerifyNonMembership(const uint256& root, const uint256& key, const SparseProof& proof){
+   return proof.ComputeRoot(key, SparseTree::GetEmptyHash(0)) == root;
+ }
+}
+
+#endif//TOKEN_SPARSE_MERKLE_H
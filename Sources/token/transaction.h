@@ -6,7 +6,16 @@
 #include "token/timestamp.h"
 
 namespace token{
- class Transaction : public SerializableObject{
+ /**
+  * The hash is cached (see BinaryObject), so the inputs and outputs must not be modified through
+  * the pointer accessors once it has been used.
+  */
+ class Transaction : public BinaryObject{
+  public:
+   // the timestamp and both counts, see Serializer::ReadList
+   static constexpr const uint64_t kMinSize = sizeof(RawTimestamp) + (2 * sizeof(UnsignedLong));
+   // a varint each for the timestamp and both counts, see ReadCompactBody
+   static constexpr const uint64_t kMinCompactBodySize = 3;
   protected:
    Timestamp timestamp_;
 
@@ -17,6 +26,7 @@ namespace token{
    uint64_t num_outputs_;
   public:
    Transaction():
+    BinaryObject(),
     timestamp_(Clock::now()),
     inputs_(nullptr),
     num_inputs_(0),
@@ -31,6 +41,7 @@ namespace token{
     * @param num_outputs The number of outputs for the transaction
     */
    Transaction(const Timestamp& timestamp, const Input* inputs, uint64_t num_inputs, const Output* outputs, uint64_t num_outputs):
+    BinaryObject(),
     timestamp_(timestamp),
     inputs_(new Input[num_inputs]),
     num_inputs_(num_inputs),
@@ -43,22 +54,18 @@ namespace token{
     Transaction(Clock::now(), inputs, num_inputs, outputs, num_outputs){
    }
    explicit Transaction(const BufferPtr& data):
-    timestamp_(data->GetTimestamp()),
+    BinaryObject(),
+    timestamp_(),
     inputs_(nullptr),
     num_inputs_(0),
     outputs_(nullptr),
     num_outputs_(0){
-     if(!data->GetList(&num_inputs_, &inputs_)){
-       LOG(FATAL) << "cannot parse inputs_ from buffer.";
-       return;
-     }
-
-     if(!data->GetList(&num_outputs_, &outputs_)){
-       LOG(FATAL) << "cannot parse outputs_ from buffer.";
-       return;
-     }
+     Reader<> reader(data);
+     if(!ReadFrom(reader) || !reader.Commit())
+       LOG(FATAL) << "cannot parse transaction from buffer.";
    }
    Transaction(const Transaction& rhs):
+    BinaryObject(),
     timestamp_(rhs.timestamp()),
     inputs_(new Input[rhs.GetNumberOfInputs()]),
     num_inputs_(rhs.GetNumberOfInputs()),
@@ -127,38 +134,135 @@ namespace token{
    uint64_t GetBufferSize() const override{
      uint64_t size = 0;
      size += sizeof(RawTimestamp);
+     size += GetListBufferSize(inputs_, GetNumberOfInputs());
+     size += GetListBufferSize(outputs_, GetNumberOfOutputs());
+     return size;
+   }
 
-     size += sizeof(uint64_t);
-     size += (GetNumberOfInputs() * Input::kSize);
+   template<class Storage>
+   bool WriteTo(Writer<Storage>& writer) const{
+     if(writer.Reserve(sizeof(RawTimestamp)))
+       writer.PutTimestamp(timestamp());
+     return Serializer<Input>::WriteList(writer, inputs_, GetNumberOfInputs())
+         && Serializer<Output>::WriteList(writer, outputs_, GetNumberOfOutputs());
+   }
 
-     size += sizeof(uint64_t);
-     size += (GetNumberOfOutputs() + Output::kSize);
-     return size;
+   // expects an empty transaction
+   template<class Storage>
+   bool ReadFrom(Reader<Storage>& reader){
+     if(!reader.Require(sizeof(RawTimestamp)))
+       return false;
+     InvalidateHash();
+     timestamp_ = reader.GetTimestamp();
+     return Serializer<Input>::ReadList(reader, &num_inputs_, &inputs_)
+         && Serializer<Output>::ReadList(reader, &num_outputs_, &outputs_);
    }
 
    bool WriteTo(const BufferPtr& data) const override{
-     if(!data->PutTimestamp(timestamp())){
-       LOG(FATAL) << "cannot put timestamp_ into buffer.";
+     Writer<> writer(data);
+     if(!WriteTo(writer) || !writer.Commit()){
+       LOG(FATAL) << "cannot put transaction into buffer.";
+       return false;
+     }
+     return true;
+   }
+
+   /**
+    * The compact encoding stores the timestamp, counts and input indices as varints and starts w/
+    * kCompactEncodingVersion. It's meant for the wire and disk, hash() always covers the fixed
+    * width encoding of WriteTo.
+    */
+   uint64_t GetCompactBufferSize() const{
+     return Buffer::GetVarintSize(kCompactEncodingVersion) + GetCompactBodySize();
+   }
+
+   bool WriteCompactTo(const BufferPtr& data) const{
+     return data->PutVarint(kCompactEncodingVersion)
+         && WriteCompactBody(data);
+   }
+
+   bool ReadCompactFrom(const BufferPtr& data){
+     uint64_t version;
+     if(!data->GetVarint(&version))
+       return false;
+     if(version != kCompactEncodingVersion){
+       LOG(ERROR) << "cannot decode compact encoding version " << version << ".";
+       return false;
+     }
+     return ReadCompactBody(data);
+   }
+
+   // the compact encoding w/o the version, for embedding into other compact encodings
+   virtual uint64_t GetCompactBodySize() const{
+     uint64_t size = 0;
+     size += Buffer::GetVarintSize(ToUnixTimestamp(timestamp()));
+     size += Buffer::GetVarintSize(GetNumberOfInputs());
+     std::for_each(inputs_begin(), inputs_end(), [&size](const Input& val){
+       size += uint256::kSize + Buffer::GetVarintSize(val.source().index());
+     });
+     size += Buffer::GetVarintSize(GetNumberOfOutputs());
+     size += (GetNumberOfOutputs() * Output::kSize);
+     return size;
+   }
+
+   virtual bool WriteCompactBody(const BufferPtr& data) const{
+     if(!data->PutVarint(ToUnixTimestamp(timestamp())) || !data->PutVarint(GetNumberOfInputs()))
        return false;
+     for(auto it = inputs_begin(); it != inputs_end(); it++){
+       if(!data->PutHash(it->source().hash()) || !data->PutVarint(it->source().index()))
+         return false;
      }
+     return data->PutVarint(GetNumberOfOutputs())
+         && data->PutRecords(outputs_, GetNumberOfOutputs());
+   }
 
-     if(!data->PutList(inputs_, GetNumberOfInputs())){
-       LOG(FATAL) << "cannot put inputs_ into buffer.";
+   virtual bool ReadCompactBody(const BufferPtr& data){
+     uint64_t timestamp, num_inputs, num_outputs;
+     if(!data->GetVarint(&timestamp) || !data->GetVarint(&num_inputs))
+       return false;
+     // don't trust the counts further than the remaining bytes can back them
+     if(num_inputs > (data->length() - data->GetReadPosition()) / (uint256::kSize + 1)){
+       LOG(ERROR) << "cannot decode " << num_inputs << " inputs from " << data->ToString() << ".";
        return false;
      }
 
-     if(!data->PutList(outputs_, GetNumberOfOutputs())){
-       LOG(FATAL) << "cannot put outputs into buffer.";
+     auto inputs = new Input[num_inputs];
+     for(uint64_t idx = 0; idx < num_inputs; idx++){
+       uint8_t hash[uint256::kSize];
+       uint64_t index;
+       if(!data->GetBytes(hash, uint256::kSize) || !data->GetVarint(&index)){
+         delete[] inputs;
+         return false;
+       }
+       inputs[idx] = Input(uint256(hash, uint256::kSize), index);
+     }
+
+     if(!data->GetVarint(&num_outputs) || num_outputs > (data->length() - data->GetReadPosition()) / Output::kSize){
+       LOG(ERROR) << "cannot decode outputs from " << data->ToString() << ".";
+       delete[] inputs;
        return false;
      }
+     auto outputs = new Output[num_outputs];
+     data->GetRecords(outputs, num_outputs); // bounds checked above
+
+     InvalidateHash();
+     timestamp_ = FromUnixTimestamp(timestamp);
+     delete[] inputs_;
+     inputs_ = inputs;
+     num_inputs_ = num_inputs;
+     delete[] outputs_;
+     outputs_ = outputs;
+     num_outputs_ = num_outputs;
      return true;
    }
 
    Transaction& operator=(const Transaction& rhs){
      if(&rhs == this)
        return *this;
+     InvalidateHash();
      timestamp_ = rhs.timestamp();
      num_inputs_ = rhs.GetNumberOfInputs();
+     num_outputs_ = rhs.GetNumberOfOutputs();
 
      delete[] inputs_;
      inputs_ = new Input[rhs.GetNumberOfInputs()];
@@ -192,6 +296,9 @@ namespace token{
  };
 
  class IndexedTransaction : public Transaction{
+  public:
+   static constexpr const uint64_t kMinSize = sizeof(UnsignedLong) + Transaction::kMinSize;
+   static constexpr const uint64_t kMinCompactBodySize = 1 + Transaction::kMinCompactBodySize;
   protected:
    uint64_t index_;
   public:
@@ -213,12 +320,10 @@ namespace token{
    }
    explicit IndexedTransaction(const BufferPtr& data):
     Transaction(),
-    index_(data->GetUnsignedLong()){
-     timestamp_ = data->GetTimestamp();
-     if(!data->GetList(&num_inputs_, &inputs_))
-       LOG(FATAL) << "cannot parse inputs_ from buffer.";
-     if(!data->GetList(&num_outputs_, &outputs_))
-       LOG(FATAL) << "cannot parse outputs_ from buffer.";
+    index_(){
+     Reader<> reader(data);
+     if(!ReadFrom(reader) || !reader.Commit())
+       LOG(FATAL) << "cannot parse transaction from buffer.";
    }
    IndexedTransaction(const IndexedTransaction& rhs):
     Transaction(rhs),
@@ -241,10 +346,45 @@ namespace token{
      return size;
    }
 
+   template<class Storage>
+   bool WriteTo(Writer<Storage>& writer) const{
+     if(writer.Reserve(sizeof(UnsignedLong)))
+       writer.PutUnsignedLong(index());
+     return Transaction::WriteTo(writer);
+   }
+
+   template<class Storage>
+   bool ReadFrom(Reader<Storage>& reader){
+     if(!reader.Require(sizeof(UnsignedLong)))
+       return false;
+     index_ = reader.GetUnsignedLong();
+     return Transaction::ReadFrom(reader);
+   }
+
    bool WriteTo(const BufferPtr& data) const override{
-     if(!data->PutUnsignedLong(index()))
+     Writer<> writer(data);
+     if(!WriteTo(writer) || !writer.Commit()){
+       LOG(FATAL) << "cannot put transaction into buffer.";
+       return false;
+     }
+     return true;
+   }
+
+   uint64_t GetCompactBodySize() const override{
+     return Buffer::GetVarintSize(index()) + Transaction::GetCompactBodySize();
+   }
+
+   bool WriteCompactBody(const BufferPtr& data) const override{
+     return data->PutVarint(index())
+         && Transaction::WriteCompactBody(data);
+   }
+
+   bool ReadCompactBody(const BufferPtr& data) override{
+     uint64_t index;
+     if(!data->GetVarint(&index) || !Transaction::ReadCompactBody(data))
        return false;
-     return Transaction::WriteTo(data);
+     index_ = index;
+     return true;
    }
 
    IndexedTransaction& operator=(const IndexedTransaction& rhs){
@@ -49,6 +49,17 @@ namespace token{
      return index_;
    }
 
+   // the hash followed by the little endian index
+   void WriteRecord(uint8_t* record) const{
+     memcpy(record, hash_.data(), uint256::kSize);
+     EncodeLittleEndian(&record[uint256::kSize], index_);
+   }
+
+   void ReadRecord(const uint8_t* record){
+     hash_ = uint256(record, uint256::kSize);
+     index_ = DecodeLittleEndian(&record[uint256::kSize]);
+   }
+
    TransactionReference& operator=(const TransactionReference& rhs){
      if(&rhs == this)
        return *this;
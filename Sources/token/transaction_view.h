@@ -0,0 +1,246 @@
+#ifndef TOKEN_TRANSACTION_VIEW_H
+#define TOKEN_TRANSACTION_VIEW_H
+
+#include <iterator>
+
+#include "token/transaction.h"
+
+namespace token{
+ /**
+  * Forward iterator over encoded records (see Serializer), a record is only decoded when it's
+  * dereferenced.
+  */
+ template<class T>
+ class RecordIterator{
+  private:
+   const uint8_t* record_;
+  public:
+   typedef std::forward_iterator_tag iterator_category;
+   typedef T value_type;
+   typedef std::ptrdiff_t difference_type;
+   typedef const T* pointer;
+   typedef T reference;
+
+   RecordIterator():
+    record_(nullptr){
+   }
+   explicit RecordIterator(const uint8_t* record):
+    record_(record){
+   }
+   RecordIterator(const RecordIterator& rhs) = default;
+   ~RecordIterator() = default;
+
+   T operator*() const{
+     T val;
+     val.ReadRecord(record_);
+     return val;
+   }
+
+   RecordIterator& operator++(){
+     record_ += T::kSize;
+     return *this;
+   }
+
+   RecordIterator operator++(int){
+     auto pos = *this;
+     record_ += T::kSize;
+     return pos;
+   }
+
+   RecordIterator& operator=(const RecordIterator& rhs) = default;
+
+   friend bool operator==(const RecordIterator& lhs, const RecordIterator& rhs){
+     return lhs.record_ == rhs.record_;
+   }
+
+   friend bool operator!=(const RecordIterator& lhs, const RecordIterator& rhs){
+     return lhs.record_ != rhs.record_;
+   }
+ };
+
+ /**
+  * Read-only access to an encoded transaction (see Transaction::WriteTo) w/o decoding it, the
+  * accessors compute their offsets into the encoded bytes. The counts are checked against the
+  * length of the buffer once on construction, a view over truncated bytes is !IsValid() and must
+  * not be accessed otherwise. The view keeps the buffer alive, but the buffer must not be written
+  * to or resized while it's in use.
+  */
+ class TransactionView{
+  public:
+   typedef RecordIterator<Input> InputIterator;
+   typedef RecordIterator<Output> OutputIterator;
+
+   static constexpr const uint64_t kInputsOffset = sizeof(RawTimestamp) + sizeof(UnsignedLong);
+
+   /**
+    * Returns the encoded size of the transaction at bytes and its counts, or 0 if it doesn't fit
+    * into length bytes.
+    */
+   static inline uint64_t
+   Parse(const uint8_t* bytes, uint64_t length, uint64_t* num_inputs, uint64_t* num_outputs){
+     if(length < kInputsOffset)
+       return 0;
+     auto inputs = DecodeLittleEndian<UnsignedLong>(&bytes[sizeof(RawTimestamp)]);
+     if(inputs > (length - kInputsOffset) / Input::kSize)
+       return 0;
+     auto pos = kInputsOffset + (inputs * Input::kSize);
+     if((length - pos) < sizeof(UnsignedLong))
+       return 0;
+     auto outputs = DecodeLittleEndian<UnsignedLong>(&bytes[pos]);
+     pos += sizeof(UnsignedLong);
+     if(outputs > (length - pos) / Output::kSize)
+       return 0;
+     (*num_inputs) = inputs;
+     (*num_outputs) = outputs;
+     return pos + (outputs * Output::kSize);
+   }
+  protected:
+   BufferPtr data_;
+   const uint8_t* bytes_; // start of the encoding, incl. the prefix
+   uint64_t prefix_; // the bytes in front of the timestamp, e.g. the index of an IndexedTransaction
+   uint64_t num_inputs_;
+   uint64_t num_outputs_;
+   uint64_t size_; // 0 if the view is invalid
+
+   TransactionView(const BufferPtr& data, uint64_t offset, uint64_t prefix):
+    data_(data),
+    bytes_(nullptr),
+    prefix_(prefix),
+    num_inputs_(0),
+    num_outputs_(0),
+    size_(0){
+     if(!data || offset > data->length() || (data->length() - offset) < prefix){
+       LOG(ERROR) << "cannot view transaction @" << offset << " in buffer.";
+       return;
+     }
+     auto bytes = &data->data()[offset];
+     auto size = Parse(&bytes[prefix], data->length() - offset - prefix, &num_inputs_, &num_outputs_);
+     if(size == 0){
+       LOG(ERROR) << "cannot view transaction @" << offset << " in " << data->ToString() << ".";
+       return;
+     }
+     bytes_ = bytes;
+     size_ = prefix + size;
+   }
+
+   inline const uint8_t*
+   body() const{
+     return &bytes_[prefix_];
+   }
+
+   inline const uint8_t*
+   GetInputRecord(uint64_t idx) const{
+     return &body()[kInputsOffset + (idx * Input::kSize)];
+   }
+
+   inline const uint8_t*
+   GetOutputRecord(uint64_t idx) const{
+     return &body()[kInputsOffset + (num_inputs_ * Input::kSize) + sizeof(UnsignedLong) + (idx * Output::kSize)];
+   }
+  public:
+   TransactionView():
+    data_(),
+    bytes_(nullptr),
+    prefix_(0),
+    num_inputs_(0),
+    num_outputs_(0),
+    size_(0){
+   }
+   explicit TransactionView(const BufferPtr& data, uint64_t offset = 0):
+    TransactionView(data, offset, 0){
+   }
+   TransactionView(const TransactionView& rhs) = default;
+   ~TransactionView() = default;
+
+   bool IsValid() const{
+     return size_ > 0;
+   }
+
+   Timestamp timestamp() const{
+     return FromUnixTimestamp(DecodeLittleEndian<UnsignedLong>(body()));
+   }
+
+   uint64_t GetNumberOfInputs() const{
+     return num_inputs_;
+   }
+
+   Input inputs(uint64_t idx) const{
+     Input val;
+     val.ReadRecord(GetInputRecord(idx));
+     return val;
+   }
+
+   InputIterator inputs_begin() const{
+     return InputIterator(GetInputRecord(0));
+   }
+
+   InputIterator inputs_end() const{
+     return InputIterator(GetInputRecord(GetNumberOfInputs()));
+   }
+
+   uint64_t GetNumberOfOutputs() const{
+     return num_outputs_;
+   }
+
+   Output outputs(uint64_t idx) const{
+     Output val;
+     val.ReadRecord(GetOutputRecord(idx));
+     return val;
+   }
+
+   OutputIterator outputs_begin() const{
+     return OutputIterator(GetOutputRecord(0));
+   }
+
+   OutputIterator outputs_end() const{
+     return OutputIterator(GetOutputRecord(GetNumberOfOutputs()));
+   }
+
+   void VisitInputs(InputVisitor* vis) const{
+     std::for_each(inputs_begin(), inputs_end(), [vis](const Input& val){
+       vis->Visit(val);
+     });
+   }
+
+   void VisitOutputs(OutputVisitor* vis) const{
+     std::for_each(outputs_begin(), outputs_end(), [vis](const Output& val){
+       vis->Visit(val);
+     });
+   }
+
+   const uint8_t* data() const{
+     return bytes_;
+   }
+
+   uint64_t GetBufferSize() const{
+     return size_;
+   }
+
+   // the view covers the same bytes the decoded transaction would hash
+   uint256 hash() const{
+     return sha256::Of(data(), GetBufferSize());
+   }
+
+   TransactionView& operator=(const TransactionView& rhs) = default;
+ };
+
+ class IndexedTransactionView : public TransactionView{
+  public:
+   IndexedTransactionView():
+    TransactionView(){
+   }
+   explicit IndexedTransactionView(const BufferPtr& data, uint64_t offset = 0):
+    TransactionView(data, offset, sizeof(UnsignedLong)){
+   }
+   IndexedTransactionView(const IndexedTransactionView& rhs) = default;
+   ~IndexedTransactionView() = default;
+
+   uint64_t index() const{
+     return DecodeLittleEndian<UnsignedLong>(data());
+   }
+
+   IndexedTransactionView& operator=(const IndexedTransactionView& rhs) = default;
+ };
+}
+
+#endif//TOKEN_TRANSACTION_VIEW_H
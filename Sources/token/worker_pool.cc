@@ -0,0 +1,96 @@
+#include <glog/logging.h>
+
+#include "token/worker_pool.h"
+
+namespace token{
+ WorkerPool::WorkerPool(uint64_t num_workers):
+  workers_(),
+  mutex_(),
+  wakeup_(),
+  finished_(),
+  queue_(nullptr),
+  generation_(0),
+  active_(0),
+  remaining_(0),
+  shutdown_(false){
+   workers_.reserve(num_workers);
+   for(auto idx = 0; idx < num_workers; idx++)
+     workers_.emplace_back(&WorkerPool::HandleWorker, this);
+   DVLOG(1) << "started worker pool w/ " << num_workers << " workers.";
+ }
+
+ WorkerPool::~WorkerPool(){
+   {
+     std::lock_guard<std::mutex> guard(mutex_);
+     shutdown_ = true;
+   }
+   wakeup_.notify_all();
+   for(auto& it : workers_)
+     it.join();
+ }
+
+ void WorkerPool::RunTask(Task* task){
+   task->Run();
+   if(remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1){
+     std::lock_guard<std::mutex> guard(mutex_);
+     finished_.notify_all();
+   }
+ }
+
+ void WorkerPool::HandleWorker(){
+   uint64_t generation = 0;
+   while(true){
+     atomic::WorkStealingQueue<Task*>* queue;
+     {
+       std::unique_lock<std::mutex> lock(mutex_);
+       wakeup_.wait(lock, [&](){
+         return shutdown_ || (queue_ != nullptr && generation_ != generation);
+       });
+       if(shutdown_)
+         return;
+       generation = generation_;
+       queue = queue_;
+       active_++;
+     }
+
+     while(!queue->empty()){
+       auto task = queue->Steal();
+       if(task != nullptr)
+         RunTask(task);
+     }
+
+     {
+       std::lock_guard<std::mutex> guard(mutex_);
+       active_--;
+     }
+     finished_.notify_all();
+   }
+ }
+
+ void WorkerPool::RunAll(const std::vector<Task*>& tasks){
+   if(tasks.empty())
+     return;
+
+   atomic::WorkStealingQueue<Task*> queue(tasks.size());
+   for(auto& it : tasks)
+     queue.Push(it);
+   remaining_.store(tasks.size(), std::memory_order_release);
+
+   {
+     std::lock_guard<std::mutex> guard(mutex_);
+     queue_ = &queue;
+     generation_++;
+   }
+   wakeup_.notify_all();
+
+   Task* task;
+   while((task = queue.Pop()) != nullptr)
+     RunTask(task);
+
+   std::unique_lock<std::mutex> lock(mutex_);
+   finished_.wait(lock, [&](){
+     return remaining_.load(std::memory_order_acquire) == 0 && active_ == 0;
+   });
+   queue_ = nullptr;
+ }
+}
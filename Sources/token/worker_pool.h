@@ -0,0 +1,58 @@
+#ifndef TOKEN_WORKER_POOL_H
+#define TOKEN_WORKER_POOL_H
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+
+#include "token/atomic/work_stealing_queue.h"
+
+namespace token{
+ class Task{
+  protected:
+   Task() = default;
+  public:
+   virtual ~Task() = default;
+   virtual void Run() = 0;
+ };
+
+ /**
+  * Fixed set of worker threads that help the calling thread drain a batch of tasks. The caller
+  * owns the batch's WorkStealingQueue (it pushes and pops), the workers steal from it.
+  */
+ class WorkerPool{
+  private:
+   std::vector<std::thread> workers_;
+   std::mutex mutex_;
+   std::condition_variable wakeup_;
+   std::condition_variable finished_;
+   atomic::WorkStealingQueue<Task*>* queue_;
+   uint64_t generation_;
+   uint64_t active_;
+   std::atomic<uint64_t> remaining_;
+   bool shutdown_;
+
+   void RunTask(Task* task);
+   void HandleWorker();
+  public:
+   explicit WorkerPool(uint64_t num_workers = std::thread::hardware_concurrency());
+   WorkerPool(const WorkerPool& rhs) = delete;
+   ~WorkerPool();
+
+   uint64_t GetNumberOfWorkers() const{
+     return workers_.size();
+   }
+
+   /**
+    * Runs every task to completion before returning, the calling thread takes part. Batches
+    * are not reentrant, only one thread may call RunAll at a time.
+    */
+   void RunAll(const std::vector<Task*>& tasks);
+
+   WorkerPool& operator=(const WorkerPool& rhs) = delete;
+ };
+}
+
+#endif//TOKEN_WORKER_POOL_H
@@ -3,6 +3,7 @@
 
 #include "helpers.h"
 #include "token/block.h"
+#include "token/block_view.h"
 
 namespace token{
  class BlockTest : public ::testing::Test{
@@ -22,4 +23,194 @@ namespace token{
  TEST_F(BlockTest, TestEquality){
 
  }
-}
\ No newline at end of file
+
+ static inline Block
+ NewBlock(uint64_t height, uint64_t num_transactions, const Timestamp& timestamp = Clock::now()){
+   std::vector<IndexedTransaction> transactions;
+   for(auto idx = 0; idx < num_transactions; idx++){
+     Input inputs[] = {
+       Input(sha256::Nonce(), idx),
+     };
+     Output outputs[] = {
+       Output("TestUser", "TestProduct"),
+     };
+     transactions.emplace_back(idx, timestamp, inputs, 1, outputs, 1);
+   }
+   return Block(height, timestamp, transactions.data(), transactions.size());
+ }
+
+ TEST(BlockHashTest, TestHash){
+   auto a = NewBlock(1, 8);
+   auto hash = a.hash();
+   ASSERT_EQ(hash, a.ComputeHash());
+   ASSERT_EQ(a.hash(), hash);
+
+   Block b(a);
+   ASSERT_EQ(b.hash(), hash);
+   ASSERT_EQ(b, a);
+
+   auto c = NewBlock(2, 4);
+   ASSERT_NE(c, a);
+   c = a;
+   ASSERT_EQ(c.hash(), hash);
+   ASSERT_EQ(c.GetNumberOfTransactions(), a.GetNumberOfTransactions());
+   ASSERT_EQ(c.ComputeHash(), hash);
+ }
+
+ TEST(BlockHashTest, TestBufferSize){
+   auto a = NewBlock(1, 8);
+   auto size = a.GetBufferSize();
+   ASSERT_EQ(a.GetBufferSize(), size);
+
+   Block b(a);
+   ASSERT_EQ(b.GetBufferSize(), size);
+   auto data = NewBuffer(size);
+   ASSERT_TRUE(a.WriteTo(data));
+   ASSERT_EQ(data->GetWritePosition(), size);
+
+   Block c(data);
+   ASSERT_EQ(c.height(), a.height());
+   ASSERT_EQ(c.GetNumberOfTransactions(), a.GetNumberOfTransactions());
+   ASSERT_EQ(c.GetBufferSize(), size);
+   ASSERT_EQ(c.hash(), a.hash());
+   ASSERT_EQ(data->GetReadPosition(), size);
+ }
+
+ TEST(BlockHashTest, TestTransactionHash){
+   Input inputs[] = {
+     Input(sha256::Nonce(), 0),
+   };
+   Output outputs[] = {
+     Output("TestUser", "TestProduct"),
+   };
+   Transaction tx(Clock::now(), inputs, 1, outputs, 1);
+   auto hash = tx.hash();
+   ASSERT_EQ(hash, tx.ComputeHash());
+
+   IndexedTransaction a(0, tx);
+   IndexedTransaction b(1, tx);
+   ASSERT_NE(a.hash(), hash);
+   ASSERT_NE(a.hash(), b.hash());
+   b = a;
+   ASSERT_EQ(b.hash(), a.hash());
+ }
+
+ TEST(BlockHashTest, TestCompact){
+   auto a = NewBlock(100, 8, FromUnixTimestamp(ToUnixTimestamp(Clock::now())));
+   auto size = a.GetCompactBufferSize();
+   ASSERT_LT(size, a.GetBufferSize());
+
+   auto data = NewGrowableBuffer();
+   ASSERT_TRUE(a.WriteCompactTo(data));
+   ASSERT_EQ(data->GetWritePosition(), size);
+
+   Block b;
+   ASSERT_TRUE(b.ReadCompactFrom(data));
+   ASSERT_EQ(b.height(), a.height());
+   ASSERT_EQ(b.GetNumberOfTransactions(), a.GetNumberOfTransactions());
+   ASSERT_EQ(b.GetBufferSize(), a.GetBufferSize());
+   ASSERT_EQ(b.hash(), a.hash());
+
+   auto truncated = NewBuffer(size - 1);
+   ASSERT_TRUE(truncated->PutBytes(data->data(), size - 1));
+   Block c;
+   ASSERT_FALSE(c.ReadCompactFrom(truncated));
+ }
+
+ TEST(BlockViewTest, TestView){
+   auto a = NewBlock(1, 8);
+   auto data = a.ToBuffer();
+   ASSERT_NE(data, nullptr);
+
+   BlockView view(data);
+   ASSERT_TRUE(view.IsValid());
+   ASSERT_EQ(view.height(), a.height());
+   ASSERT_EQ(view.GetNumberOfTransactions(), a.GetNumberOfTransactions());
+   ASSERT_EQ(view.GetBufferSize(), a.GetBufferSize());
+   ASSERT_EQ(view.hash(), a.hash());
+   ASSERT_EQ(view.transactions(5).hash(), a.transactions()[5].hash());
+
+   uint64_t idx = 0;
+   for(auto it = view.transactions_begin(); it != view.transactions_end(); it++, idx++){
+     auto tx = *it;
+     ASSERT_TRUE(tx.IsValid());
+     ASSERT_EQ(tx.index(), a.transactions()[idx].index());
+     ASSERT_EQ(tx.inputs(0), *a.transactions()[idx].inputs(0));
+   }
+   ASSERT_EQ(idx, a.GetNumberOfTransactions());
+   ASSERT_FALSE(view.transactions(a.GetNumberOfTransactions()).IsValid());
+
+   // iterators outlive the view and compare equal across copies of it
+   auto first = BlockView(data).transactions_begin();
+   ASSERT_EQ((*first).hash(), a.transactions()[0].hash());
+   BlockView copy(view);
+   ASSERT_EQ(copy.transactions_end(), view.transactions_end());
+
+   auto truncated = NewBuffer(data->length() - 1);
+   ASSERT_TRUE(truncated->PutBytes(data->data(), data->length() - 1));
+   ASSERT_FALSE(BlockView(truncated).IsValid());
+
+   auto empty = NewBlock(2, 0).ToBuffer();
+   BlockView b(empty);
+   ASSERT_TRUE(b.IsValid());
+   ASSERT_EQ(b.transactions_begin(), b.transactions_end());
+ }
+
+ TEST(BlockTableTest, TestLazy){
+   auto a = NewBlock(7, 8);
+   auto size = a.GetTableBufferSize();
+   ASSERT_EQ(size, a.GetBufferSize() + ((a.GetNumberOfTransactions() + 1) * sizeof(uint64_t)));
+   auto data = NewBuffer(size);
+   ASSERT_TRUE(a.WriteTableTo(data));
+   ASSERT_EQ(data->GetWritePosition(), size);
+
+   Block b;
+   ASSERT_TRUE(b.ReadTableFrom(data));
+   ASSERT_TRUE(b.IsLazy());
+   ASSERT_EQ(b.height(), a.height());
+   ASSERT_EQ(b.GetNumberOfTransactions(), a.GetNumberOfTransactions());
+   ASSERT_EQ(b.GetBufferSize(), a.GetBufferSize());
+   ASSERT_EQ(b.hash(), a.hash());
+   ASSERT_FALSE(b.IsDecoded(0));
+
+   ASSERT_EQ(b.GetTransaction(3).hash(), a.transactions()[3].hash());
+   ASSERT_TRUE(b.IsDecoded(3));
+   ASSERT_FALSE(b.IsDecoded(2));
+
+   Block c(b);
+   ASSERT_TRUE(c.IsDecoded(3));
+   ASSERT_FALSE(c.IsDecoded(2));
+   ASSERT_EQ(c.ComputeHash(), a.hash());
+   for(uint64_t idx = 0; idx < a.GetNumberOfTransactions(); idx++)
+     ASSERT_EQ(c.transactions()[idx].hash(), a.transactions()[idx].hash());
+   ASSERT_TRUE(c.IsDecoded(2));
+
+   auto copy = NewBuffer(size);
+   ASSERT_TRUE(b.WriteTableTo(copy));
+   ASSERT_EQ(memcmp(copy->data(), data->data(), size), 0);
+
+   Block d(b.ToBuffer());
+   ASSERT_EQ(d.hash(), a.hash());
+
+   auto truncated = NewBuffer(size - 1);
+   ASSERT_TRUE(truncated->PutBytes(data->data(), size - 1));
+   Block e;
+   ASSERT_FALSE(e.ReadTableFrom(truncated));
+
+   // an offset out of order is rejected up front, not when the transaction is accessed
+   auto corrupt = NewBuffer(size);
+   ASSERT_TRUE(corrupt->PutBytes(data->data(), size));
+   auto offset = Block::kHeaderSize + (3 * sizeof(uint64_t));
+   ASSERT_TRUE(corrupt->PutUnsignedLong(data->GetUnsignedLong(offset + (2 * sizeof(uint64_t))), offset));
+   ASSERT_FALSE(e.ReadTableFrom(corrupt));
+   ASSERT_TRUE(corrupt->PutUnsignedLong(size + 1, offset));
+   ASSERT_FALSE(e.ReadTableFrom(corrupt));
+
+   // so is a transaction whose counts don't match its extent
+   auto miscounted = NewBuffer(size);
+   ASSERT_TRUE(miscounted->PutBytes(data->data(), size));
+   auto num_inputs = data->GetUnsignedLong(offset) + sizeof(uint64_t) + sizeof(uint64_t);
+   ASSERT_TRUE(miscounted->PutUnsignedLong(data->GetUnsignedLong(num_inputs) + 1, num_inputs));
+   ASSERT_FALSE(e.ReadTableFrom(miscounted));
+ }
+}
@@ -1,3 +1,5 @@
+#include <limits>
+#include <unistd.h>
 #include <gtest/gtest.h>
 #include <glog/logging.h>
 
@@ -62,4 +64,282 @@ namespace token{
 
  FOR_EACH_BUFFER_TYPE(DEFINE_STACK_BUFFER_TYPE_TEST_CASE)
  FOR_EACH_BUFFER_TYPE(DEFINE_HEAP_BUFFER_TYPE_TEST_CASE)
-}
\ No newline at end of file
+ TEST(HashingBufferTest, TestHash){
+   auto large = sha256::Nonce();
+   auto data = NewBuffer(1024 + ((sizeof(UnsignedLong) + uint256::kSize) * 64));
+   auto sink = std::make_shared<HashingBuffer>();
+   for(auto idx = 0; idx < 64; idx++){
+     ASSERT_TRUE(data->PutUnsignedLong(idx));
+     ASSERT_TRUE(sink->PutUnsignedLong(idx));
+     ASSERT_TRUE(data->PutHash(large));
+     ASSERT_TRUE(sink->PutHash(large));
+   }
+
+   std::vector<uint8_t> bytes(1024, 0xAB);
+   ASSERT_TRUE(data->PutBytes(bytes.data(), bytes.size()));
+   ASSERT_TRUE(sink->PutBytes(bytes.data(), bytes.size()));
+   ASSERT_EQ(sink->GetBytesWritten(), data->GetWritePosition());
+   ASSERT_EQ(sink->GetHash(), sha256::Of(data->data(), data->GetWritePosition()));
+ }
+
+ TEST(GrowableBufferTest, TestGrow){
+   auto data = NewGrowableBuffer(8);
+   for(auto idx = 0; idx < 1000; idx++)
+     ASSERT_TRUE(data->PutUnsignedLong(idx));
+   auto hash = sha256::Nonce();
+   ASSERT_TRUE(data->PutHash(hash));
+   ASSERT_EQ(data->GetWritePosition(), (1000 * sizeof(UnsignedLong)) + uint256::kSize);
+   ASSERT_GE(data->length(), data->GetWritePosition());
+
+   for(auto idx = 0; idx < 1000; idx++)
+     ASSERT_EQ(data->GetUnsignedLong(), idx);
+   ASSERT_EQ(data->GetHash(), hash);
+
+   ASSERT_TRUE(data->ShrinkToFit());
+   ASSERT_EQ(data->length(), data->GetWritePosition());
+ }
+
+ TEST(GrowableBufferTest, TestEmpty){
+   auto data = NewGrowableBuffer(0);
+   ASSERT_TRUE(data->IsUnallocated());
+   ASSERT_TRUE(data->PutUnsignedInt(10));
+   ASSERT_EQ(data->GetUnsignedInt(), 10);
+ }
+
+ static inline std::string
+ GetTempFilename(const std::string& name){
+   return testing::TempDir() + "token-" + name;
+ }
+
+ TEST(MappedBufferTest, TestReadOnly){
+   auto filename = GetTempFilename("mapped-read");
+   auto data = NewGrowableBuffer();
+   for(auto idx = 0; idx < 10000; idx++)
+     ASSERT_TRUE(data->PutUnsignedLong(idx));
+   FILE* file = fopen(filename.data(), "wb");
+   ASSERT_TRUE(data->WriteTo(file));
+   fclose(file);
+
+   auto mapped = NewMappedBuffer(filename);
+   ASSERT_NE(mapped, nullptr);
+   ASSERT_EQ(mapped->length(), data->GetWritePosition());
+   ASSERT_EQ(mapped->GetWritePosition(), data->GetWritePosition());
+   for(auto idx = 0; idx < 10000; idx++)
+     ASSERT_EQ(mapped->GetUnsignedLong(), idx);
+   ASSERT_FALSE(mapped->PutUnsignedLong(0));
+   ASSERT_TRUE(mapped->Advise(MappedBuffer::kRandom));
+
+   auto prefix = NewBufferFromFile(filename, sizeof(UnsignedLong) * 10);
+   ASSERT_NE(prefix, nullptr);
+   ASSERT_EQ(prefix->length(), sizeof(UnsignedLong) * 10);
+   ASSERT_EQ(prefix->GetUnsignedLong(), 0);
+
+   ASSERT_EQ(NewBufferFromFile(filename, data->GetWritePosition() + 1), nullptr);
+   ASSERT_EQ(NewMappedBuffer(GetTempFilename("mapped-missing")), nullptr);
+   unlink(filename.data());
+ }
+
+ TEST(MappedBufferTest, TestReadWrite){
+   auto filename = GetTempFilename("mapped-write");
+   unlink(filename.data());
+   {
+     auto mapped = NewMappedBuffer(filename, MappedBuffer::kReadWrite, MappedBuffer::kSequential, 1024);
+     ASSERT_NE(mapped, nullptr);
+     ASSERT_EQ(mapped->length(), 1024);
+     ASSERT_EQ(mapped->GetWritePosition(), 0);
+     ASSERT_TRUE(mapped->PutUnsignedLong(42));
+     ASSERT_TRUE(mapped->PutString("Hello World"));
+     ASSERT_TRUE(mapped->Sync());
+   }
+
+   auto mapped = NewMappedBuffer(filename);
+   ASSERT_NE(mapped, nullptr);
+   ASSERT_EQ(mapped->length(), 1024);
+   ASSERT_EQ(mapped->GetUnsignedLong(), 42);
+   ASSERT_EQ(mapped->GetUnsignedLong(), 11);
+   char text[11];
+   ASSERT_TRUE(mapped->GetBytes((uint8_t*) text, sizeof(text)));
+   ASSERT_EQ(std::string(text, sizeof(text)), "Hello World");
+   ASSERT_FALSE(mapped->Sync());
+   unlink(filename.data());
+ }
+
+ TEST(SliceBufferTest, TestSlice){
+   auto data = NewBuffer(sizeof(UnsignedLong) * 4);
+   for(auto idx = 0; idx < 4; idx++)
+     ASSERT_TRUE(data->PutUnsignedLong(idx));
+
+   auto slice = data->Slice(sizeof(UnsignedLong), sizeof(UnsignedLong) * 2);
+   ASSERT_NE(slice, nullptr);
+   ASSERT_EQ(slice->data(), data->data() + sizeof(UnsignedLong));
+   ASSERT_EQ(slice->length(), sizeof(UnsignedLong) * 2);
+   ASSERT_EQ(slice->GetWritePosition(), slice->length());
+   ASSERT_EQ(slice->GetUnsignedLong(), 1);
+   ASSERT_EQ(slice->GetUnsignedLong(), 2);
+
+   // writes go through to the parent
+   ASSERT_TRUE(slice->PutUnsignedLong(10, 0));
+   ASSERT_EQ(data->GetUnsignedLong(), 0);
+   ASSERT_EQ(data->GetUnsignedLong(), 10);
+
+   auto nested = slice->Slice(sizeof(UnsignedLong), sizeof(UnsignedLong));
+   ASSERT_NE(nested, nullptr);
+   ASSERT_EQ(std::static_pointer_cast<SliceBuffer>(nested)->GetParent(), data);
+   ASSERT_EQ(nested->GetUnsignedLong(), 2);
+
+   ASSERT_EQ(data->Slice(sizeof(UnsignedLong) * 3, sizeof(UnsignedLong) * 2), nullptr);
+   ASSERT_EQ(slice->Slice(0, slice->length() + 1), nullptr);
+
+   // the slice keeps the storage alive
+   data.reset();
+   ASSERT_EQ(nested->GetReadPosition(), sizeof(UnsignedLong));
+   nested->SetReadPosition(0);
+   ASSERT_EQ(nested->GetUnsignedLong(), 2);
+ }
+
+ TEST(SliceBufferTest, TestReadSlice){
+   auto data = NewGrowableBuffer(8);
+   ASSERT_TRUE(data->PutUnsignedLong(1));
+   ASSERT_TRUE(data->PutString("Hello World"));
+   ASSERT_TRUE(data->PutUnsignedLong(2));
+
+   ASSERT_EQ(data->GetUnsignedLong(), 1);
+   auto length = data->GetUnsignedLong();
+   auto text = data->ReadSlice(length);
+   ASSERT_NE(text, nullptr);
+   ASSERT_EQ(std::string((const char*) text->data(), text->length()), "Hello World");
+   ASSERT_EQ(data->GetUnsignedLong(), 2);
+   ASSERT_EQ(data->ReadSlice(data->length()), nullptr);
+
+   // growing the parent moves its storage, the slice follows
+   for(auto idx = 0; idx < 1000; idx++)
+     ASSERT_TRUE(data->PutUnsignedLong(idx));
+   ASSERT_EQ(std::string((const char*) text->data(), text->length()), "Hello World");
+ }
+
+ TEST(VarintTest, TestRoundTrip){
+   static const uint64_t kValues[] = {
+     0, 1, 127, 128, 300, 16383, 16384, 1ull << 35, (1ull << 56) - 1, 1ull << 56, 1ull << 63,
+     std::numeric_limits<uint64_t>::max(),
+   };
+   auto data = NewGrowableBuffer();
+   for(auto& it : kValues)
+     ASSERT_TRUE(data->PutVarint(it));
+   for(auto& it : kValues){
+     auto pos = data->GetReadPosition();
+     uint64_t value;
+     ASSERT_TRUE(data->GetVarint(&value));
+     ASSERT_EQ(value, it);
+     ASSERT_EQ(data->GetReadPosition() - pos, Buffer::GetVarintSize(it));
+   }
+
+   // exactly sized buffers only take the byte-wise path
+   for(auto& it : kValues){
+     auto exact = NewBuffer(Buffer::GetVarintSize(it));
+     ASSERT_TRUE(exact->PutVarint(it));
+     uint64_t value;
+     ASSERT_TRUE(exact->GetVarint(&value));
+     ASSERT_EQ(value, it);
+   }
+   ASSERT_EQ(Buffer::GetVarintSize(std::numeric_limits<uint64_t>::max()), Buffer::kMaxVarintSize);
+ }
+
+ TEST(VarintTest, TestMalformed){
+   uint64_t value;
+   auto truncated = NewBuffer(2);
+   ASSERT_TRUE(truncated->PutUnsignedByte(0x80));
+   ASSERT_TRUE(truncated->PutUnsignedByte(0x80));
+   ASSERT_FALSE(truncated->GetVarint(&value));
+   ASSERT_EQ(truncated->GetReadPosition(), 0);
+
+   auto overflow = NewBuffer(16);
+   for(auto idx = 0; idx < 9; idx++)
+     ASSERT_TRUE(overflow->PutUnsignedByte(0xFF));
+   ASSERT_TRUE(overflow->PutUnsignedByte(0x02));
+   ASSERT_FALSE(overflow->GetVarint(&value));
+ }
+
+ TEST(CursorTest, TestWriter){
+   auto data = NewBuffer(sizeof(UnsignedLong) + uint256::kSize);
+   auto hash = sha256::Nonce();
+   auto storage = std::static_pointer_cast<AllocatedBuffer>(data);
+   Writer<AllocatedBuffer> writer(storage);
+   ASSERT_TRUE(writer.Reserve(sizeof(UnsignedLong) + uint256::kSize));
+   writer.PutUnsignedLong(10);
+   writer.PutHash(hash);
+   // a full buffer that can't grow fails once the staged bytes are handed to it
+   ASSERT_TRUE(writer.Reserve(1));
+   writer.PutUnsignedByte(1);
+   ASSERT_FALSE(writer.Commit());
+   ASSERT_FALSE(writer.Reserve(0));
+   ASSERT_EQ(data->GetWritePosition(), data->length());
+   ASSERT_EQ(data->GetUnsignedLong(), 10);
+   ASSERT_EQ(data->GetHash(), hash);
+
+   auto small = NewBuffer(Writer<>::kScratchSize);
+   Writer<> oversized(small);
+   ASSERT_TRUE(oversized.Reserve(Writer<>::kScratchSize));
+   oversized.PutUnsignedByte(1);
+   ASSERT_FALSE(oversized.Reserve(Writer<>::kScratchSize + 1));
+   ASSERT_FALSE(oversized.Commit());
+ }
+
+ TEST(CursorTest, TestWriterOverflow){
+   // streaming and growing sinks are fed through the scratch space
+   auto sink = std::make_shared<HashingBuffer>();
+   auto data = NewGrowableBuffer(8);
+   Writer<HashingBuffer> hashing(sink);
+   Writer<GrowableBuffer> growable(data);
+   for(auto idx = 0; idx < 1000; idx++){
+     ASSERT_TRUE(hashing.Reserve(sizeof(UnsignedLong)));
+     hashing.PutUnsignedLong(idx);
+     ASSERT_TRUE(growable.Reserve(sizeof(UnsignedLong)));
+     growable.PutUnsignedLong(idx);
+   }
+   ASSERT_TRUE(hashing.Commit());
+   ASSERT_TRUE(growable.Commit());
+   ASSERT_EQ(data->GetWritePosition(), 1000 * sizeof(UnsignedLong));
+   ASSERT_EQ(sink->GetHash(), sha256::Of(data->data(), data->GetWritePosition()));
+
+   Reader<GrowableBuffer> reader(data);
+   ASSERT_TRUE(reader.Require(1000 * sizeof(UnsignedLong)));
+   for(auto idx = 0; idx < 1000; idx++)
+     ASSERT_EQ(reader.GetUnsignedLong(), idx);
+   ASSERT_TRUE(reader.Commit());
+   ASSERT_EQ(data->GetReadPosition(), 1000 * sizeof(UnsignedLong));
+ }
+
+ TEST(CursorTest, TestReader){
+   auto data = NewBuffer(sizeof(UnsignedLong));
+   ASSERT_TRUE(data->PutUnsignedLong(42));
+   Reader<> reader(data);
+   ASSERT_TRUE(reader.Require(sizeof(UnsignedLong)));
+   ASSERT_EQ(reader.GetUnsignedLong(), 42);
+   ASSERT_FALSE(reader.Require(1));
+   ASSERT_FALSE(reader.Require(0));
+   ASSERT_FALSE(reader.Commit());
+   ASSERT_EQ(data->GetReadPosition(), sizeof(UnsignedLong));
+ }
+
+ TEST(CursorTest, TestByteOrder){
+   static const uint8_t kExpected[] = { 0x08, 0x07, 0x06, 0x05, 0x04, 0x03, 0x02, 0x01, 0x0B, 0x0A };
+   auto data = NewBuffer(sizeof(kExpected));
+   ASSERT_TRUE(data->PutUnsignedLong(0x0102030405060708ull));
+   ASSERT_TRUE(data->PutUnsignedShort(0x0A0B));
+   ASSERT_EQ(memcmp(data->data(), kExpected, sizeof(kExpected)), 0);
+
+   auto copy = NewBuffer(sizeof(kExpected));
+   Writer<> writer(copy);
+   ASSERT_TRUE(writer.Reserve(sizeof(kExpected)));
+   writer.PutUnsignedLong(0x0102030405060708ull);
+   writer.PutUnsignedShort(0x0A0B);
+   ASSERT_TRUE(writer.Commit());
+   ASSERT_EQ(memcmp(copy->data(), kExpected, sizeof(kExpected)), 0);
+
+   Reader<> reader(copy);
+   ASSERT_TRUE(reader.Require(sizeof(kExpected)));
+   ASSERT_EQ(reader.GetUnsignedLong(), 0x0102030405060708ull);
+   ASSERT_EQ(reader.GetUnsignedShort(), 0x0A0B);
+   ASSERT_EQ(data->GetUnsignedLong(0), 0x0102030405060708ull);
+ }
+}
@@ -0,0 +1,90 @@
+#include <thread>
+#include <gtest/gtest.h>
+#include <glog/logging.h>
+
+#include "token/buffer.h"
+#include "token/buffer_pool.h"
+
+namespace token{
+ TEST(BufferPoolTest, TestGetAllocationSize){
+   ASSERT_EQ(BufferPool::GetAllocationSize(0), 0);
+   ASSERT_EQ(BufferPool::GetAllocationSize(1), BufferPool::kMinSize);
+   ASSERT_EQ(BufferPool::GetAllocationSize(BufferPool::kMinSize), BufferPool::kMinSize);
+   ASSERT_EQ(BufferPool::GetAllocationSize(BufferPool::kMinSize + 1), BufferPool::kMinSize * 2);
+   ASSERT_EQ(BufferPool::GetAllocationSize(1000), 1024);
+   ASSERT_EQ(BufferPool::GetAllocationSize(BufferPool::kMaxSize), BufferPool::kMaxSize);
+   ASSERT_EQ(BufferPool::GetAllocationSize(BufferPool::kMaxSize + 1), BufferPool::kMaxSize + 1);
+   ASSERT_EQ(BufferPool::GetSizeClass(BufferPool::kMaxSize), BufferPool::kNumberOfSizeClasses - 1);
+ }
+
+ TEST(BufferPoolTest, TestReuse){
+   BufferPool::Trim();
+   auto data = BufferPool::Allocate(1000);
+   ASSERT_NE(data, nullptr);
+   memset(data, 0xFF, 1024);
+   BufferPool::Free(data, 1000);
+
+   auto before = BufferPool::GetStats();
+   ASSERT_GE(before.resident_bytes, 1024);
+   auto next = BufferPool::Allocate(600);
+   ASSERT_EQ(next, data);
+   auto after = BufferPool::GetStats();
+   ASSERT_EQ(after.hits, before.hits + 1);
+   ASSERT_EQ(after.misses, before.misses);
+   BufferPool::Free(next, 600);
+ }
+
+ TEST(BufferPoolTest, TestLargeAllocation){
+   static constexpr const uint64_t kSize = BufferPool::kMaxSize * 2;
+   auto before = BufferPool::GetStats();
+   auto data = BufferPool::Allocate(kSize);
+   ASSERT_NE(data, nullptr);
+   memset(data, 0, kSize);
+   ASSERT_EQ(BufferPool::GetStats().allocated_bytes, before.allocated_bytes + kSize);
+   BufferPool::Free(data, kSize);
+   ASSERT_EQ(BufferPool::GetStats().resident_bytes, before.resident_bytes);
+   ASSERT_EQ(BufferPool::Allocate(0), nullptr);
+ }
+
+ TEST(BufferPoolTest, TestNewBuffer){
+   auto data = NewBuffer(100);
+   ASSERT_EQ(data->length(), 100);
+   ASSERT_TRUE(data->PutUnsignedLong(10));
+   ASSERT_EQ(data->GetUnsignedLong(), 10);
+ }
+
+ TEST(BufferPoolTest, TestThreads){
+   static constexpr const uint64_t kNumberOfThreads = 4;
+   static constexpr const uint64_t kNumberOfIterations = 10000;
+
+   // buffers are freed on other threads than the ones that allocated them
+   std::vector<BufferPtr> shared(kNumberOfThreads * kNumberOfIterations);
+   std::vector<std::thread> threads;
+   for(auto idx = 0; idx < kNumberOfThreads; idx++){
+     threads.emplace_back([&shared, idx](){
+       for(auto iteration = 0; iteration < kNumberOfIterations; iteration++){
+         auto data = NewBuffer(((idx * kNumberOfIterations) + iteration) % 4096 + 1);
+         data->PutByte(static_cast<uint8_t>(iteration));
+         shared[(idx * kNumberOfIterations) + iteration] = data;
+       }
+     });
+   }
+   for(auto& it : threads)
+     it.join();
+   threads.clear();
+
+   for(auto idx = 0; idx < kNumberOfThreads; idx++){
+     threads.emplace_back([&shared, idx](){
+       for(auto iteration = 0; iteration < kNumberOfIterations; iteration++)
+         shared[(((idx + 1) % kNumberOfThreads) * kNumberOfIterations) + iteration].reset();
+     });
+   }
+   for(auto& it : threads)
+     it.join();
+
+   auto stats = BufferPool::GetStats();
+   DLOG(INFO) << stats;
+   ASSERT_GT(stats.hits, 0);
+   ASSERT_GT(stats.GetHitRate(), 0.0);
+ }
+}
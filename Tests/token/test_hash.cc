@@ -3,6 +3,7 @@
 
 #include "helpers.h"
 #include "token/hash.h"
+#include "token/sha256_kernels.h"
 
 namespace token{
  TEST(SHA256Test, TestHexString){
@@ -23,4 +24,154 @@ namespace token{
    uint256 h3 = sha256::Concat(h1, h2);
    ASSERT_EQ(h3.HexString(), "408AD6E74422A9581F48BAA6DA698D04B4BD419480EFA1F2713946CE1E8E7605");
  }
-}
\ No newline at end of file
+
+ TEST(SHA256Test, TestOfBatch){
+   std::vector<std::vector<uint8_t>> messages;
+   for(auto length = 0; length < 300; length++){
+     std::vector<uint8_t> message(length);
+     for(auto idx = 0; idx < length; idx++)
+       message[idx] = static_cast<uint8_t>(length + idx);
+     messages.push_back(message);
+   }
+
+   std::vector<leveldb::Slice> slices;
+   for(auto& it : messages)
+     slices.emplace_back((const char*) it.data(), it.size());
+
+   auto results = sha256::OfBatch(slices);
+   ASSERT_EQ(results.size(), messages.size());
+   for(auto idx = 0; idx < messages.size(); idx++)
+     ASSERT_EQ(results[idx], sha256::Of(messages[idx].data(), messages[idx].size())) << "message #" << idx;
+ }
+
+ TEST(SHA256Test, TestTransformKernels){
+   uint8_t blocks[sha256::internal::kBlockSize * 3];
+   for(auto idx = 0; idx < sizeof(blocks); idx++)
+     blocks[idx] = static_cast<uint8_t>(idx * 7);
+
+   uint32_t expected[sha256::internal::kStateSize];
+   sha256::internal::InitializeState(expected);
+   sha256::internal::TransformScalar(expected, blocks, 3);
+
+#ifdef ARCHITECTURE_IS_X64
+   if(sha256::internal::HasShaExtensions()){
+     uint32_t state[sha256::internal::kStateSize];
+     sha256::internal::InitializeState(state);
+     sha256::internal::TransformShaNi(state, blocks, 3);
+     ASSERT_TRUE(std::equal(state, state + sha256::internal::kStateSize, expected));
+   }
+
+   if(sha256::internal::HasAvx2()){
+     static constexpr const uint64_t kLanes = sha256::internal::kAvx2Lanes;
+     uint32_t states[sha256::internal::kStateSize * kLanes];
+     for(auto word = 0; word < sha256::internal::kStateSize; word++){
+       for(auto lane = 0; lane < kLanes; lane++)
+         states[(word * kLanes) + lane] = sha256::internal::kInitialState[word];
+     }
+
+     for(auto block = 0; block < 3; block++){
+       const uint8_t* lanes[kLanes];
+       std::fill(lanes, lanes + kLanes, &blocks[block * sha256::internal::kBlockSize]);
+       sha256::internal::Transform8WayAvx2(states, lanes, 0x7F); // the last lane stays at the initial state
+     }
+
+     for(auto word = 0; word < sha256::internal::kStateSize; word++){
+       for(auto lane = 0; lane < kLanes - 1; lane++)
+         ASSERT_EQ(states[(word * kLanes) + lane], expected[word]);
+       ASSERT_EQ(states[(word * kLanes) + kLanes - 1], sha256::internal::kInitialState[word]);
+     }
+   }
+#endif//ARCHITECTURE_IS_X64
+ }
+
+ TEST(SHA256Test, TestHasher){
+   std::vector<uint8_t> message(1000);
+   for(auto idx = 0; idx < message.size(); idx++)
+     message[idx] = static_cast<uint8_t>(idx * 13);
+
+   sha256::Hasher hasher;
+   for(auto chunk : { 1, 7, 63, 64, 65, 200 }){
+     uint64_t offset = 0;
+     while(offset < message.size()){
+       auto length = std::min(static_cast<uint64_t>(chunk), message.size() - offset);
+       hasher.Update(&message[offset], length);
+       offset += length;
+     }
+     ASSERT_EQ(hasher.Final(), sha256::Of(message.data(), message.size())) << "chunk size " << chunk;
+   }
+   ASSERT_EQ(hasher.Final(), sha256::Of(nullptr, 0));
+ }
+
+ TEST(SHA256Test, TestHashPair){
+   std::vector<uint256> nodes;
+   for(auto idx = 0; idx < 2 * 19; idx++)
+     nodes.push_back(sha256::Nonce(64));
+
+   std::vector<uint256> results(nodes.size() / 2);
+   sha256::HashPairs(nodes.data(), results.size(), results.data());
+   for(auto idx = 0; idx < results.size(); idx++){
+     auto& lhs = nodes[idx * 2];
+     auto& rhs = nodes[(idx * 2) + 1];
+     uint8_t data[uint256::kSize * 2];
+     memcpy(&data[0], lhs.data(), uint256::kSize);
+     memcpy(&data[uint256::kSize], rhs.data(), uint256::kSize);
+
+     auto expected = sha256::Of(data, sizeof(data));
+     ASSERT_EQ(sha256::HashPair(lhs, rhs), expected);
+     ASSERT_EQ(results[idx], expected) << "pair #" << idx;
+
+     uint256 scalar;
+     sha256::internal::HashPairScalar(lhs.data(), rhs.data(), &scalar[0]);
+     ASSERT_EQ(scalar, expected);
+#ifdef ARCHITECTURE_IS_X64
+     if(sha256::internal::HasShaExtensions()){
+       uint256 shani;
+       sha256::internal::HashPairShaNi(lhs.data(), rhs.data(), &shani[0]);
+       ASSERT_EQ(shani, expected);
+     }
+#endif//ARCHITECTURE_IS_X64
+   }
+ }
+
+ TEST(UInt256Test, TestCompare){
+   std::vector<uint256> values;
+   for(auto idx = 0; idx < 32; idx++)
+     values.push_back(sha256::Nonce());
+   // values that only differ in one byte, including the last byte of each word
+   for(auto idx = 0; idx < uint256::kSize; idx++){
+     uint256 val;
+     val[idx] = 0x80;
+     values.push_back(val);
+     val[idx] = 0x01;
+     values.push_back(val);
+   }
+   values.emplace_back();
+
+   for(auto& lhs : values){
+     for(auto& rhs : values){
+       auto expected = memcmp(lhs.data(), rhs.data(), uint256::kSize);
+       auto result = uint256::Compare(lhs, rhs);
+       ASSERT_EQ(result < 0, expected < 0) << lhs << " vs " << rhs;
+       ASSERT_EQ(result > 0, expected > 0) << lhs << " vs " << rhs;
+       ASSERT_EQ(lhs == rhs, expected == 0);
+       ASSERT_EQ(lhs != rhs, expected != 0);
+     }
+   }
+ }
+
+ TEST(UInt256Test, TestHash){
+   std::unordered_set<uint256> hashes;
+   for(auto idx = 0; idx < uint256::kSize; idx++){
+     uint256 val;
+     val[idx] = 0x01;
+     ASSERT_TRUE(hashes.insert(val).second);
+     ASSERT_NE(std::hash<uint256>()(val), std::hash<uint256>()(uint256()));
+   }
+   uint256 duplicate = *hashes.begin();
+   ASSERT_FALSE(hashes.insert(duplicate).second);
+   ASSERT_EQ(hashes.size(), uint256::kSize);
+
+   auto nonce = sha256::Nonce();
+   ASSERT_EQ(std::hash<uint256>()(nonce), std::hash<uint256>()(uint256(nonce)));
+ }
+}
@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+#include <glog/logging.h>
+
+#include "helpers.h"
+#include "token/hash.h"
+#include "token/hex.h"
+
+namespace token{
+ static inline std::vector<uint8_t>
+ RandomBytes(uint64_t length){
+   std::vector<uint8_t> data(length);
+   for(auto& it : data)
+     it = static_cast<uint8_t>(rand());
+   return data;
+ }
+
+ TEST(HexTest, TestEncode){
+   for(auto length = 0; length < 200; length++){
+     auto data = RandomBytes(length);
+     std::string expected(length * 2, '\0');
+     hex::internal::EncodeScalar(data.data(), length, &expected[0]);
+
+     std::string result(length * 2, '\0');
+     hex::Encode(data.data(), length, &result[0]);
+     ASSERT_EQ(result, expected) << length << " bytes";
+
+     std::vector<uint8_t> decoded(length);
+     ASSERT_TRUE(hex::Decode(result.data(), result.length(), decoded.data()));
+     ASSERT_EQ(decoded, data) << length << " bytes";
+   }
+ }
+
+ TEST(HexTest, TestDecodeLowerCase){
+   static constexpr const char* kHexString = "b6ff77862b24e765056ec25e59749a6e834acf74e393efd7d7f4f8b219181531";
+   uint256 hash;
+   ASSERT_TRUE(sha256::ParseHex(std::string(kHexString), hash));
+   ASSERT_EQ(hash, sha256::FromHex("B6FF77862B24E765056EC25E59749A6E834ACF74E393EFD7D7F4F8B219181531"));
+ }
+
+ TEST(HexTest, TestDecodeInvalid){
+   auto data = RandomBytes(100);
+   std::string encoded(200, '\0');
+   hex::Encode(data.data(), data.size(), &encoded[0]);
+
+   std::vector<uint8_t> decoded(data.size());
+   ASSERT_FALSE(hex::Decode(encoded.data(), encoded.length() - 1, decoded.data()));
+   for(auto pos = 0; pos < encoded.length(); pos++){
+     for(auto c : { 'G', 'g', '/', ':', '@', '`', ' ', '\x80' }){
+       auto invalid = encoded;
+       invalid[pos] = c;
+       ASSERT_FALSE(hex::Decode(invalid.data(), invalid.length(), decoded.data())) << "'" << c << "' at " << pos;
+     }
+   }
+ }
+
+ TEST(HexTest, TestToHex){
+   auto hash = sha256::Nonce();
+   char result[uint256::kHexSize];
+   hash.ToHex(result);
+   ASSERT_EQ(std::string(result, uint256::kHexSize), hash.HexString());
+
+   uint256 parsed;
+   ASSERT_TRUE(sha256::ParseHex(result, parsed));
+   ASSERT_EQ(parsed, hash);
+   ASSERT_FALSE(sha256::ParseHex(std::string(result, uint256::kHexSize - 2), parsed));
+ }
+}
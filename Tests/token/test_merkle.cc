@@ -3,6 +3,7 @@
 
 #include "helpers.h"
 #include "token/merkle.h"
+#include "token/worker_pool.h"
 
 namespace token{
  using namespace token::merkle;
@@ -68,4 +69,199 @@ namespace token{
  TEST_F(MerkleTreeTest, TestRoot){
    ASSERT_TRUE(IsRoot(tree(), kRoot));
  }
-}
\ No newline at end of file
+
+ static inline uint256
+ ComputeRoot(std::vector<uint256> level){
+   if(level.size() == 1)
+     level.push_back(level.back());
+   while(level.size() > 1){
+     if((level.size() % 2) == 1)
+       level.push_back(level.back());
+     std::vector<uint256> parents;
+     for(auto idx = 0; idx < level.size(); idx += 2)
+       parents.push_back(sha256::Concat(level[idx], level[idx + 1]));
+     level = parents;
+   }
+   return level.front();
+ }
+
+ TEST(MerkleTest, TestOddNumberOfLeaves){
+   for(auto num_leaves : { 1, 3, 5, 6, 7, 9, 17, 33 }){
+     std::vector<uint256> leaves;
+     for(auto idx = 0; idx < num_leaves; idx++)
+       leaves.push_back(sha256::Nonce(32));
+     Tree tree(leaves);
+     ASSERT_TRUE(IsRoot(&tree, ComputeRoot(leaves))) << num_leaves << " leaves";
+     ASSERT_TRUE(tree.root()->VerifyHash());
+     ASSERT_EQ(tree.root()->GetLeaves(), num_leaves);
+     for(auto& it : leaves)
+       ASSERT_TRUE(HasNode(&tree, it));
+   }
+ }
+
+ TEST(FlatTreeTest, TestRoot){
+   for(auto num_leaves : { 1, 2, 3, 4, 5, 8, 11, 16, 33, 100 }){
+     std::vector<uint256> leaves;
+     for(auto idx = 0; idx < num_leaves; idx++)
+       leaves.push_back(sha256::Nonce(32));
+     Tree tree(leaves);
+     FlatTree flat(leaves);
+     ASSERT_EQ(flat.GetRootHash(), tree.GetRootHash()) << num_leaves << " leaves";
+     ASSERT_EQ(flat.GetNumberOfLeaves(), num_leaves);
+     ASSERT_EQ(flat.GetLevelSize(flat.GetNumberOfLevels() - 1), 1);
+     for(auto idx = 0; idx < num_leaves; idx++)
+       ASSERT_EQ(flat.GetLeaf(idx), leaves[idx]);
+   }
+ }
+
+ TEST(FlatTreeTest, TestEmpty){
+   FlatTree flat({});
+   ASSERT_TRUE(flat.empty());
+   ASSERT_EQ(flat.GetNumberOfLevels(), 0);
+   ASSERT_EQ(flat.GetRootHash(), uint256());
+ }
+
+ TEST(FlatTreeTest, TestParallelRoot){
+   WorkerPool pool(4);
+   for(auto num_leaves : { 100, 4096, 50001 }){
+     std::vector<uint256> leaves;
+     for(auto idx = 0; idx < num_leaves; idx++)
+       leaves.push_back(sha256::Nonce(32));
+     FlatTree serial(leaves);
+     FlatTree parallel(leaves, &pool);
+     ASSERT_EQ(parallel.GetRootHash(), serial.GetRootHash()) << num_leaves << " leaves";
+     ASSERT_EQ(parallel.GetRootHash(), ComputeRoot(leaves)) << num_leaves << " leaves";
+   }
+ }
+
+ TEST(MerkleTest, TestProof){
+   for(auto num_leaves : { 1, 2, 3, 5, 8, 13, 64, 100 }){
+     std::vector<uint256> leaves;
+     for(auto idx = 0; idx < num_leaves; idx++)
+       leaves.push_back(sha256::Nonce(32));
+     Tree tree(leaves);
+     FlatTree flat(leaves);
+     for(auto idx = 0; idx < num_leaves; idx++){
+       Proof proof;
+       ASSERT_TRUE(tree.GetProof(leaves[idx], proof));
+       ASSERT_TRUE(VerifyProof(tree.GetRootHash(), leaves[idx], proof)) << "leaf " << idx << "/" << num_leaves;
+       ASSERT_FALSE(VerifyProof(tree.GetRootHash(), sha256::Nonce(), proof));
+
+       Proof flat_proof;
+       ASSERT_TRUE(flat.GetProof(idx, flat_proof));
+       ASSERT_EQ(flat_proof, proof);
+     }
+   }
+
+   std::vector<uint256> leaves = { sha256::Nonce(), sha256::Nonce(), sha256::Nonce() };
+   Tree tree(leaves);
+   Proof proof;
+   ASSERT_FALSE(tree.GetProof(sha256::Nonce(), proof));
+   ASSERT_FALSE(tree.GetProof(tree.GetRootHash(), proof));
+   ASSERT_FALSE(VerifyProof(tree.GetRootHash(), leaves[0], Proof()));
+ }
+
+ TEST(MerkleTest, TestProofSerialization){
+   std::vector<uint256> leaves;
+   for(auto idx = 0; idx < 37; idx++)
+     leaves.push_back(sha256::Nonce(32));
+   Tree tree(leaves);
+   Proof proof;
+   ASSERT_TRUE(tree.GetProof(leaves[21], proof));
+
+   auto buffer = NewBuffer(proof.GetBufferSize());
+   ASSERT_TRUE(proof.WriteTo(buffer));
+   ASSERT_EQ(buffer->GetWritePosition(), proof.GetBufferSize());
+   Proof decoded(buffer);
+   ASSERT_EQ(decoded, proof);
+   ASSERT_TRUE(VerifyProof(tree.GetRootHash(), leaves[21], decoded));
+ }
+
+ TEST(MerkleTest, TestGetLeaves){
+   std::vector<uint256> leaves;
+   for(auto idx = 0; idx < 11; idx++)
+     leaves.push_back(sha256::Nonce(32));
+   Tree tree(leaves);
+
+   std::vector<uint256> result;
+   ASSERT_TRUE(tree.GetLeaves(result));
+   ASSERT_EQ(result, leaves);
+
+   std::vector<uint256> nodes;
+   ASSERT_TRUE(tree.GetNodes(nodes));
+   ASSERT_EQ(nodes.size(), FlatTree(leaves).GetNumberOfNodes());
+   ASSERT_EQ(nodes.front(), tree.GetRootHash());
+ }
+
+ TEST(MerkleTest, TestGetNode){
+   std::vector<uint256> leaves;
+   for(auto idx = 0; idx < 29; idx++)
+     leaves.push_back(sha256::Nonce(32));
+   leaves.push_back(leaves.front());
+   Tree tree(leaves);
+
+   std::vector<uint256> nodes;
+   ASSERT_TRUE(tree.GetNodes(nodes));
+   for(auto& it : nodes){
+     auto node = tree.GetNode(it);
+     ASSERT_NE(node, nullptr);
+     ASSERT_EQ(node->hash(), it);
+   }
+   ASSERT_EQ(tree.GetNode(tree.GetRootHash()), tree.root());
+   ASSERT_TRUE(tree.GetNode(leaves.front())->IsLeaf());
+   ASSERT_EQ(tree.GetNode(sha256::Nonce()), nullptr);
+
+   Proof proof;
+   ASSERT_TRUE(tree.GetProof(leaves.front(), proof));
+   ASSERT_TRUE(VerifyProof(tree.GetRootHash(), leaves.front(), proof));
+ }
+
+ TEST(AccumulatorTest, TestRoot){
+   Accumulator accumulator;
+   ASSERT_TRUE(accumulator.empty());
+   ASSERT_EQ(accumulator.GetRootHash(), uint256());
+
+   std::vector<uint256> leaves;
+   for(auto idx = 0; idx < 130; idx++){
+     leaves.push_back(sha256::Nonce(32));
+     accumulator.Append(leaves.back());
+     ASSERT_EQ(accumulator.GetNumberOfLeaves(), leaves.size());
+     ASSERT_EQ(accumulator.GetRootHash(), FlatTree(leaves).GetRootHash()) << leaves.size() << " leaves";
+   }
+   ASSERT_EQ(Accumulator(leaves).GetRootHash(), accumulator.GetRootHash());
+ }
+
+ TEST(MerkleTest, TestUpdateLeaves){
+   for(auto num_leaves : { 1, 2, 7, 16, 45 }){
+     std::vector<uint256> leaves;
+     for(auto idx = 0; idx < num_leaves; idx++)
+       leaves.push_back(sha256::Nonce(32));
+     Tree tree(leaves);
+     FlatTree flat(leaves);
+
+     std::vector<Tree::LeafUpdate> updates;
+     for(auto idx = 0; idx < num_leaves; idx += 3){
+       updates.emplace_back(idx, sha256::Nonce(32));
+       leaves[idx] = updates.back().second;
+     }
+     updates.emplace_back(0, leaves.back());
+     leaves[0] = leaves.back();
+
+     ASSERT_TRUE(tree.UpdateLeaves(updates));
+     ASSERT_TRUE(flat.UpdateLeaves(updates));
+     ASSERT_EQ(tree.GetRootHash(), ComputeRoot(leaves)) << num_leaves << " leaves";
+     ASSERT_EQ(flat.GetRootHash(), ComputeRoot(leaves)) << num_leaves << " leaves";
+     ASSERT_TRUE(tree.root()->VerifyHash());
+     for(auto idx = 0; idx < num_leaves; idx++){
+       ASSERT_EQ(tree.GetLeaf(idx)->hash(), leaves[idx]);
+       Proof proof;
+       ASSERT_TRUE(tree.GetProof(leaves[idx], proof));
+       ASSERT_TRUE(VerifyProof(tree.GetRootHash(), leaves[idx], proof));
+     }
+     ASSERT_NE(tree.GetNode(tree.GetRootHash()), nullptr);
+
+     ASSERT_FALSE(tree.UpdateLeaves({ Tree::LeafUpdate(num_leaves, sha256::Nonce()) }));
+     ASSERT_FALSE(flat.UpdateLeaves({ Tree::LeafUpdate(num_leaves, sha256::Nonce()) }));
+   }
+ }
+}
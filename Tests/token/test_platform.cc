@@ -0,0 +1,26 @@
+#include <gtest/gtest.h>
+#include <glog/logging.h>
+
+#include "token/platform.h"
+
+namespace token{
+ TEST(CpuTest, TestFeatures){
+   auto features = cpu::GetFeatures();
+   ASSERT_EQ(cpu::GetFeatures(), features);
+   ASSERT_TRUE(cpu::HasFeatures(0));
+   ASSERT_TRUE(cpu::HasFeatures(features));
+   DLOG(INFO) << "cpu features: " << cpu::GetFeaturesString();
+#ifdef ARCHITECTURE_IS_X64
+   ASSERT_EQ(cpu::HasFeatures(cpu::kSsse3), __builtin_cpu_supports("ssse3") != 0);
+   ASSERT_EQ(cpu::HasFeatures(cpu::kSse42), __builtin_cpu_supports("sse4.2") != 0);
+   ASSERT_EQ(cpu::HasFeatures(cpu::kAvx2), __builtin_cpu_supports("avx2") != 0);
+   ASSERT_EQ(cpu::HasFeatures(cpu::kShaNi), __builtin_cpu_supports("sha") != 0);
+   ASSERT_FALSE(cpu::HasFeatures(cpu::kArmSha2));
+#endif//ARCHITECTURE_IS_X64
+ }
+
+ TEST(CpuTest, TestFeaturesString){
+   ASSERT_EQ(cpu::GetFeaturesString(0), "");
+   ASSERT_EQ(cpu::GetFeaturesString(cpu::kAvx2 | cpu::kShaNi), "avx2 sha");
+ }
+}
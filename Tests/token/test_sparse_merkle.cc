@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include <glog/logging.h>
+
+#include "helpers.h"
+#include "token/sparse_merkle.h"
+
+namespace token{
+ using namespace token::merkle;
+
+ static inline SparseTree
+ NewSparseTree(const std::map<uint256, uint256>& entries){
+   SparseTree tree;
+   for(auto& it : entries)
+     tree.Insert(it.first, it.second);
+   return tree;
+ }
+
+ TEST(SparseTreeTest, TestEmpty){
+   SparseTree tree;
+   ASSERT_TRUE(tree.empty());
+   ASSERT_EQ(tree.GetRootHash(), SparseTree::GetEmptyHash(SparseTree::kDepth));
+
+   SparseProof proof;
+   auto key = sha256::Nonce();
+   ASSERT_TRUE(tree.GetProof(key, proof));
+   ASSERT_EQ(proof.GetNumberOfSiblings(), 0);
+   ASSERT_TRUE(VerifyNonMembership(tree.GetRootHash(), key, proof));
+ }
+
+ TEST(SparseTreeTest, TestSingleLeaf){
+   auto key = sha256::Nonce();
+   auto value = sha256::Nonce();
+   SparseTree tree;
+   tree.Insert(key, value);
+
+   auto hash = SparseTree::GetLeafHash(key, value);
+   for(auto height = 0; height < SparseTree::kDepth; height++){
+     auto sibling = SparseTree::GetEmptyHash(height);
+     hash = SparseTree::GetBit(key, SparseTree::kDepth - height - 1) ? sha256::HashPair(sibling, hash) : sha256::HashPair(hash, sibling);
+   }
+   ASSERT_EQ(tree.GetRootHash(), hash);
+
+   ASSERT_TRUE(tree.Remove(key));
+   ASSERT_FALSE(tree.Remove(key));
+   ASSERT_EQ(tree.GetRootHash(), SparseTree::GetEmptyHash(SparseTree::kDepth));
+ }
+
+ TEST(SparseTreeTest, TestUpdate){
+   std::map<uint256, uint256> entries;
+   for(auto idx = 0; idx < 64; idx++)
+     entries.insert({ sha256::Nonce(), sha256::Nonce() });
+   // keys that only differ in their last bit
+   auto key = sha256::Nonce();
+   key[uint256::kSize - 1] &= 0xFE;
+   entries.insert({ key, sha256::Nonce() });
+   key[uint256::kSize - 1] |= 0x01;
+   entries.insert({ key, sha256::Nonce() });
+
+   auto tree = NewSparseTree(entries);
+   auto root = tree.GetRootHash();
+   ASSERT_NE(root, SparseTree::GetEmptyHash(SparseTree::kDepth));
+
+   std::vector<SparseTree::Entry> insertions;
+   std::vector<uint256> removals;
+   for(auto idx = 0; idx < 8; idx++)
+     insertions.emplace_back(sha256::Nonce(), sha256::Nonce());
+   insertions.emplace_back(entries.begin()->first, sha256::Nonce());
+   auto pos = entries.begin();
+   for(auto idx = 0; idx < 5; idx++)
+     removals.push_back((++pos)->first);
+   removals.push_back(key);
+
+   tree.Update(insertions, removals);
+   for(auto& it : insertions)
+     entries[it.first] = it.second;
+   for(auto& it : removals)
+     entries.erase(it);
+   ASSERT_EQ(tree.size(), entries.size());
+   ASSERT_EQ(tree.GetRootHash(), NewSparseTree(entries).GetRootHash());
+   ASSERT_NE(tree.GetRootHash(), root);
+ }
+
+ TEST(SparseTreeTest, TestProof){
+   std::map<uint256, uint256> entries;
+   for(auto idx = 0; idx < 100; idx++)
+     entries.insert({ sha256::Nonce(), sha256::Nonce() });
+   auto tree = NewSparseTree(entries);
+   auto root = tree.GetRootHash();
+
+   for(auto& it : entries){
+     SparseProof proof;
+     ASSERT_TRUE(tree.GetProof(it.first, proof));
+     ASSERT_TRUE(VerifyMembership(root, it.first, it.second, proof));
+     ASSERT_FALSE(VerifyMembership(root, it.first, sha256::Nonce(), proof));
+     ASSERT_FALSE(VerifyNonMembership(root, it.first, proof));
+   }
+
+   auto absent = sha256::Nonce();
+   SparseProof proof;
+   ASSERT_TRUE(tree.GetProof(absent, proof));
+   ASSERT_TRUE(VerifyNonMembership(root, absent, proof));
+   ASSERT_FALSE(VerifyMembership(root, absent, sha256::Nonce(), proof));
+
+   auto buffer = NewBuffer(proof.GetBufferSize());
+   ASSERT_TRUE(proof.WriteTo(buffer));
+   SparseProof decoded(buffer);
+   ASSERT_EQ(decoded, proof);
+   ASSERT_TRUE(VerifyNonMembership(root, absent, decoded));
+ }
+
+ TEST(SparseTreeTest, TestGetKey){
+   auto hash = sha256::Nonce();
+   auto key = SparseTree::GetKey(TransactionReference(hash, 0));
+   ASSERT_EQ(key, SparseTree::GetKey(TransactionReference(hash, 0)));
+   ASSERT_NE(key, SparseTree::GetKey(TransactionReference(hash, 1)));
+ }
+}
@@ -1,8 +1,10 @@
+#include <limits>
 #include <gtest/gtest.h>
 #include <glog/logging.h>
 
 #include "helpers.h"
 #include "token/transaction.h"
+#include "token/transaction_view.h"
 
 namespace token{
  class TransactionTest : public ::testing::Test{
@@ -81,4 +83,188 @@ namespace token{
    ASSERT_TRUE(InputsEqual(b, inputs, 1));
    ASSERT_TRUE(OutputsEqual(b, outputs, 1));
  }
-}
\ No newline at end of file
+
+ TEST(TransactionBufferTest, TestToBuffer){
+   Input inputs[] = {
+     Input(sha256::Nonce(), 0),
+     Input(sha256::Nonce(), 1),
+   };
+   Output outputs[] = {
+     Output("TestUser", "TestProduct"),
+     Output("TestUser2", "TestProduct"),
+     Output("TestUser3", "TestProduct"),
+   };
+   IndexedTransaction a(10, FromUnixTimestamp(ToUnixTimestamp(Clock::now())), inputs, 2, outputs, 3);
+   auto data = a.ToBuffer();
+   ASSERT_NE(data, nullptr);
+   ASSERT_EQ(data->GetWritePosition(), a.GetBufferSize());
+   ASSERT_EQ(data->length(), a.GetBufferSize());
+
+   IndexedTransaction b(data);
+   ASSERT_EQ(b, a);
+   ASSERT_EQ(b.hash(), a.hash());
+ }
+
+ TEST(TransactionBufferTest, TestCompact){
+   Input inputs[] = {
+     Input(sha256::Nonce(), 0),
+     Input(sha256::Nonce(), 1000),
+   };
+   Output outputs[] = {
+     Output("TestUser", "TestProduct"),
+     Output("TestUser2", "TestProduct"),
+   };
+   IndexedTransaction a(10, FromUnixTimestamp(ToUnixTimestamp(Clock::now())), inputs, 2, outputs, 2);
+   auto size = a.GetCompactBufferSize();
+   ASSERT_LT(size, a.GetBufferSize());
+
+   auto data = NewBuffer(size);
+   ASSERT_TRUE(a.WriteCompactTo(data));
+   ASSERT_EQ(data->GetWritePosition(), size);
+
+   IndexedTransaction b;
+   ASSERT_TRUE(b.ReadCompactFrom(data));
+   ASSERT_EQ(b, a);
+   ASSERT_EQ(b.hash(), a.hash());
+
+   data->SetReadPosition(0);
+   ASSERT_TRUE(data->PutUnsignedByte(kCompactEncodingVersion + 1, 0));
+   ASSERT_FALSE(b.ReadCompactFrom(data));
+ }
+
+ TEST(TransactionBufferTest, TestRecords){
+   static constexpr const uint64_t kNumberOfOutputs = 10000;
+   Input inputs[] = {
+     Input(sha256::Nonce(), 0),
+     Input(sha256::Nonce(), std::numeric_limits<uint64_t>::max()),
+   };
+   std::vector<Output> outputs;
+   for(auto idx = 0; idx < kNumberOfOutputs; idx++)
+     outputs.emplace_back("TestUser" + std::to_string(idx), "TestProduct");
+
+   // same bytes as the per element encoding
+   auto records = NewBuffer(sizeof(uint64_t) + (2 * Input::kSize));
+   ASSERT_TRUE(records->PutRecordList(inputs, 2));
+   auto list = NewBuffer(sizeof(uint64_t) + (2 * Input::kSize));
+   ASSERT_TRUE(list->PutList(inputs, 2));
+   ASSERT_EQ(memcmp(records->data(), list->data(), list->length()), 0);
+
+   Transaction a(FromUnixTimestamp(ToUnixTimestamp(Clock::now())), inputs, 2, outputs.data(), outputs.size());
+   auto data = NewGrowableBuffer();
+   ASSERT_TRUE(a.WriteTo(data));
+   ASSERT_EQ(data->GetWritePosition(), a.GetBufferSize());
+   Transaction b(data);
+   ASSERT_EQ(b, a);
+   ASSERT_EQ(b.hash(), a.hash());
+
+   uint64_t length;
+   Output* result;
+   auto truncated = NewBuffer(sizeof(uint64_t) + Output::kSize);
+   ASSERT_TRUE(truncated->PutUnsignedLong(2));
+   ASSERT_FALSE(truncated->GetRecordList(&length, &result));
+
+   // count * kSize wraps around to 24
+   static constexpr const uint64_t kForgedCount = 461168601842738791ull;
+   static_assert(kForgedCount * Input::kSize == 24);
+   auto forged = NewBuffer(sizeof(RawTimestamp) + sizeof(uint64_t) + Input::kSize);
+   ASSERT_TRUE(forged->PutUnsignedLong(0));
+   ASSERT_TRUE(forged->PutUnsignedLong(kForgedCount));
+   ASSERT_TRUE(forged->PutBytes(std::string(Input::kSize, '\0')));
+   Reader<> reader(forged, sizeof(RawTimestamp), forged->length());
+   Input* inputs_result;
+   ASSERT_FALSE(reader.GetRecordList(&length, &inputs_result));
+   ASSERT_FALSE(reader.ok());
+
+   Transaction tx;
+   Reader<> tx_reader(forged);
+   ASSERT_FALSE(tx.ReadFrom(tx_reader));
+   ASSERT_EQ(tx.GetNumberOfInputs(), 0);
+ }
+
+ TEST(SerializerTest, TestTraits){
+   static_assert(Serializer<User>::kIsFixedSize && Serializer<User>::kFixedSize == User::kSize);
+   static_assert(Serializer<Product>::kIsFixedSize && Serializer<Product>::kFixedSize == Product::kSize);
+   static_assert(Serializer<TransactionReference>::kIsFixedSize);
+   static_assert(Serializer<Input>::kIsFixedSize && Serializer<Input>::kFixedSize == 40);
+   static_assert(Serializer<Output>::kIsFixedSize && Serializer<Output>::kFixedSize == 128);
+   static_assert(!Serializer<Transaction>::kIsFixedSize);
+   static_assert(!Serializer<IndexedTransaction>::kIsFixedSize);
+   static_assert(Serializer<IndexedTransaction>::kMinSize == 32);
+   static_assert(Serializer<Output>::GetBufferSize(nullptr, 10000) == 10000 * Output::kSize);
+
+   Input inputs[] = {
+     Input(sha256::Nonce(), 0),
+   };
+   Output outputs[] = {
+     Output("TestUser", "TestProduct"),
+   };
+   std::vector<IndexedTransaction> transactions;
+   for(auto idx = 0; idx < 4; idx++)
+     transactions.emplace_back(idx, FromUnixTimestamp(ToUnixTimestamp(Clock::now())), inputs, 1, outputs, 1);
+
+   auto size = GetListBufferSize(transactions.data(), transactions.size());
+   ASSERT_EQ(size, sizeof(UnsignedLong) + (transactions.size() * transactions[0].GetBufferSize()));
+   auto data = NewBuffer(size);
+   ASSERT_TRUE(data->PutList(transactions.data(), transactions.size()));
+   ASSERT_EQ(data->GetWritePosition(), size);
+
+   uint64_t length;
+   IndexedTransaction* result;
+   ASSERT_TRUE(data->GetList(&length, &result));
+   ASSERT_EQ(length, transactions.size());
+   for(auto idx = 0; idx < length; idx++)
+     ASSERT_EQ(result[idx], transactions[idx]);
+   delete[] result;
+
+   // the smallest transaction still takes kMinSize bytes, so this count can't fit
+   IndexedTransaction empty(0, Clock::now(), nullptr, 0, nullptr, 0);
+   ASSERT_EQ(empty.GetBufferSize(), IndexedTransaction::kMinSize);
+   auto forged = NewBuffer(sizeof(UnsignedLong) + (4 * IndexedTransaction::kMinSize));
+   ASSERT_TRUE(forged->PutUnsignedLong(5));
+   ASSERT_TRUE(forged->PutBytes(std::string(4 * IndexedTransaction::kMinSize, '\0')));
+   Reader<> reader(forged);
+   ASSERT_FALSE(Serializer<IndexedTransaction>::ReadList(reader, &length, &result));
+   ASSERT_FALSE(reader.ok());
+ }
+
+ TEST(TransactionViewTest, TestView){
+   Input inputs[] = {
+     Input(sha256::Nonce(), 0),
+     Input(sha256::Nonce(), 1),
+   };
+   Output outputs[] = {
+     Output("TestUser", "TestProduct"),
+     Output("TestUser2", "TestProduct"),
+     Output("TestUser3", "TestProduct"),
+   };
+   IndexedTransaction a(10, FromUnixTimestamp(ToUnixTimestamp(Clock::now())), inputs, 2, outputs, 3);
+   auto data = a.ToBuffer();
+   ASSERT_NE(data, nullptr);
+
+   IndexedTransactionView view(data);
+   ASSERT_TRUE(view.IsValid());
+   ASSERT_EQ(view.index(), a.index());
+   ASSERT_TRUE(TimestampsAreEqual(view.timestamp(), a.timestamp()));
+   ASSERT_EQ(view.GetNumberOfInputs(), a.GetNumberOfInputs());
+   ASSERT_EQ(view.GetNumberOfOutputs(), a.GetNumberOfOutputs());
+   ASSERT_EQ(view.inputs(1), inputs[1]);
+   ASSERT_EQ(view.outputs(2), outputs[2]);
+   ASSERT_TRUE(std::equal(view.inputs_begin(), view.inputs_end(), a.inputs_begin()));
+   ASSERT_TRUE(std::equal(view.outputs_begin(), view.outputs_end(), a.outputs_begin()));
+   ASSERT_EQ(view.GetBufferSize(), a.GetBufferSize());
+   ASSERT_EQ(view.hash(), a.hash());
+
+   // a plain transaction at an offset
+   Transaction b(a.timestamp(), inputs, 2, outputs, 3);
+   auto offset = NewBuffer(sizeof(uint64_t) + b.GetBufferSize());
+   ASSERT_TRUE(offset->PutUnsignedLong(0));
+   ASSERT_TRUE(b.WriteTo(offset));
+   TransactionView c(offset, sizeof(uint64_t));
+   ASSERT_TRUE(c.IsValid());
+   ASSERT_EQ(c.hash(), b.hash());
+
+   auto truncated = NewBuffer(data->length() - 1);
+   ASSERT_TRUE(truncated->PutBytes(data->data(), data->length() - 1));
+   ASSERT_FALSE(IndexedTransactionView(truncated).IsValid());
+ }
+}
@@ -0,0 +1,47 @@
+#include <gtest/gtest.h>
+#include <glog/logging.h>
+
+#include "token/worker_pool.h"
+
+namespace token{
+ class CountingTask : public Task{
+  private:
+   std::atomic<uint64_t>* counter_;
+  public:
+   explicit CountingTask(std::atomic<uint64_t>* counter):
+    Task(),
+    counter_(counter){
+   }
+   ~CountingTask() override = default;
+
+   void Run() override{
+     counter_->fetch_add(1);
+   }
+ };
+
+ TEST(WorkerPoolTest, TestRunAll){
+   static constexpr const uint64_t kNumberOfTasks = 1000;
+
+   WorkerPool pool(4);
+   ASSERT_EQ(pool.GetNumberOfWorkers(), 4);
+
+   std::atomic<uint64_t> counter(0);
+   std::vector<CountingTask> tasks(kNumberOfTasks, CountingTask(&counter));
+   std::vector<Task*> batch;
+   for(auto& it : tasks)
+     batch.push_back(&it);
+
+   for(auto idx = 1; idx <= 10; idx++){
+     pool.RunAll(batch);
+     ASSERT_EQ(counter.load(), idx * kNumberOfTasks);
+   }
+ }
+
+ TEST(WorkerPoolTest, TestNoWorkers){
+   WorkerPool pool(0);
+   std::atomic<uint64_t> counter(0);
+   CountingTask task(&counter);
+   pool.RunAll({ &task, &task });
+   ASSERT_EQ(counter.load(), 2);
+ }
+}